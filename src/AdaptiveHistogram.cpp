@@ -0,0 +1,162 @@
+#include "cl_defines.h"
+#include "AdaptiveHistogram.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <cassert>
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+/*
+Constructor creates empty histogram. Range of histogram is defined by first added numbers and grows when number outside of the range is added.
+Every growth doubles width of bins (neighbouring bins are merged), so count of bins stays the same and at least quarter of bins always covers the data.
+int bin_count = count of fine bins, should be much higher than count of intervals created by Sturges rule
+*/
+AdaptiveHistogram::AdaptiveHistogram(int bin_count)
+{
+	this->bin_count = bin_count + (bin_count % 2); //merging of pairs requires even count
+	this->range_valid = false;
+	this->range_low = 0;
+	this->bin_width = 0;
+	this->bin_counter = std::vector<long long>(this->bin_count, 0);
+	this->bin_counter_local = tbb::enumerable_thread_specific<std::vector<long long>>(std::vector<long long>(this->bin_count, 0));
+}
+
+/*
+Adds counters of all threads into merged counter and clears counters of threads. Must be done before bins are merged (thread counters would refer to old bins).
+*/
+void AdaptiveHistogram::flush_local_bins()
+{
+	for (std::vector<long long>& local_counter : this->bin_counter_local) {
+		for (int i = 0; i < this->bin_count; i++) {
+			this->bin_counter[i] += local_counter[i];
+		}
+		std::fill(local_counter.begin(), local_counter.end(), 0);
+	}
+}
+
+/*
+Extends range of histogram so that it covers given values. Each step doubles width of bins - pairs of neighbouring bins are merged and the freed half of bins is placed on the side where value lies outside of range.
+double min_value = lowest value which must be covered
+double max_value = highest value which must be covered
+*/
+void AdaptiveHistogram::grow_range(double min_value, double max_value)
+{
+	bool flushed = false;
+	int half_count = this->bin_count / 2;
+
+	while (min_value < this->range_low || max_value >= this->range_low + this->bin_width * this->bin_count) {
+		if (!flushed) { //range changes only exceptionally, flush threads just once
+			this->flush_local_bins();
+			flushed = true;
+		}
+
+		std::vector<long long> merged_counter(this->bin_count, 0);
+		int merged_start = 0; //index of first merged bin in new histogram
+		if (min_value < this->range_low) { //extend to the left, old range ends up in upper half
+			merged_start = half_count;
+			this->range_low -= this->bin_width * this->bin_count;
+		}
+
+		for (int i = 0; i < half_count; i++) {
+			merged_counter[merged_start + i] = this->bin_counter[2 * i] + this->bin_counter[2 * i + 1];
+		}
+
+		this->bin_counter = merged_counter;
+		this->bin_width *= 2;
+	}
+}
+
+/*
+Adds numbers into histogram. Histogram range is extended by minimum + maximum of the numbers if required (known from first round statistics of the chunk, numbers are not swept for them again) and then numbers are sorted into bins by more threads.
+num_span_struct input_nums = valid numbers to add (std::fpclassify gives FP_NORMAL / FP_ZERO)
+double min_value = minimum of the numbers
+double max_value = maximum of the numbers
+*/
+void AdaptiveHistogram::add_nums(num_span_struct input_nums, double min_value, double max_value)
+{
+	if (input_nums.size == 0) {
+		return;
+	}
+
+	const double* nums = input_nums.nums;
+
+	if (!this->range_valid) { //first numbers, define initial range by them
+		this->range_low = min_value;
+		this->bin_width = (max_value - min_value) / (this->bin_count - 1); //upper boundary of range is exclusive, maximum must fall into last bin (not behind it)
+		if (this->bin_width <= 0) { //all numbers same so far, pick width by magnitude of the number
+			this->bin_width = std::max(std::abs(min_value), 1.0) * DBL_EPSILON * 1024;
+		}
+		this->range_valid = true;
+
+		double initial_bin_width = this->bin_width;
+		this->grow_range(min_value, max_value);
+		assert(this->bin_width == initial_bin_width); //range defined by the chunk must cover it without growth
+		(void)initial_bin_width;
+	}
+	else {
+		this->grow_range(min_value, max_value);
+	}
+
+	const double range_low = this->range_low;
+	const double bin_width_inv = 1 / this->bin_width;
+	const int last_bin = this->bin_count - 1;
+	auto tbb_add_nums_to_bins = [&](tbb::blocked_range<size_t> br) {
+		std::vector<long long>& bin_counter_thread = this->bin_counter_local.local();
+		for (size_t i = br.begin(); i < br.end(); i++) {
+			int bin_index = static_cast<int>((nums[i] - range_low) * bin_width_inv);
+			bin_counter_thread[std::min(std::max(bin_index, 0), last_bin)] += 1; //rounding can move number just behind the boundary
+		}
+	};
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, input_nums.size), tbb_add_nums_to_bins);
+}
+
+/*
+Distributes content of fine bins into intervals defined by interval manager (Sturges rule). Bin which lies inside one interval is added whole, bin which overlaps boundary of intervals is split between them by length of the overlap (numbers are expected to be spread evenly inside one fine bin).
+Bins are limited by dataset min / max before splitting, error of the result is therefore given only by distribution of numbers inside bins overlapping boundaries.
+IntervalManager* intervalManager = defines intervals into which numbers are sorted
+return = counter of numbers for each interval
+*/
+std::vector<long long> AdaptiveHistogram::calc_interval_counter(IntervalManager* intervalManager)
+{
+	this->flush_local_bins();
+
+	int interval_count = intervalManager->get_interval_count();
+	double interval_size = intervalManager->get_interval_size();
+	double min_value_data = intervalManager->get_first_interval_bound_low();
+	double max_value_data = intervalManager->get_last_interval_bound_up();
+
+	std::vector<double> interval_counter_part(interval_count, 0); //counts including parts of split bins
+	for (int i = 0; i < this->bin_count; i++) {
+		if (this->bin_counter[i] == 0) {
+			continue;
+		}
+
+		double bin_low = std::max(this->range_low + i * this->bin_width, min_value_data);
+		double bin_up = std::min(this->range_low + (i + 1) * this->bin_width, max_value_data);
+		int interval_low = std::min(std::max(static_cast<int>((bin_low - min_value_data) / interval_size), 0), interval_count - 1);
+		int interval_up = std::min(std::max(static_cast<int>((bin_up - min_value_data) / interval_size), 0), interval_count - 1);
+
+		if (interval_low == interval_up || bin_up <= bin_low) { //whole bin inside one interval
+			interval_counter_part[interval_low] += static_cast<double>(this->bin_counter[i]);
+			continue;
+		}
+
+		for (int j = interval_low; j <= interval_up; j++) { //split bin by overlap with each interval
+			double overlap_low = std::max(bin_low, min_value_data + j * interval_size);
+			double overlap_up = std::min(bin_up, min_value_data + (j + 1) * interval_size);
+			if (j == interval_up) { //last interval includes upper boundary
+				overlap_up = bin_up;
+			}
+			if (overlap_up > overlap_low) {
+				interval_counter_part[j] += this->bin_counter[i] * (overlap_up - overlap_low) / (bin_up - bin_low);
+			}
+		}
+	}
+
+	std::vector<long long> interval_counter(interval_count, 0);
+	for (int i = 0; i < interval_count; i++) {
+		interval_counter[i] = std::llround(interval_counter_part[i]);
+	}
+	return interval_counter;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+#include "Structures.h"
+#include "IntervalManager.h"
+#include "tbb/enumerable_thread_specific.h"
+
+//fine histogram with range which grows (by merging neighbouring bins) when number outside of the range is added; used when whole file is read only once
+class AdaptiveHistogram
+{
+	private:
+		int bin_count; //count of fine bins (even number, stays the same when range grows)
+		bool range_valid; //false until first number is added
+		double range_low; //lower boundary of first bin
+		double bin_width; //width of each bin
+		std::vector<long long> bin_counter; //merged counters of all threads
+		tbb::enumerable_thread_specific<std::vector<long long>> bin_counter_local; //counters of each thread, merged into bin_counter before range changes
+
+		void flush_local_bins(); //adds counters of all threads into bin_counter
+		void grow_range(double min_value, double max_value); //doubles bin width until range covers given values
+
+	public:
+		AdaptiveHistogram(int bin_count); //constructor expects count of fine bins
+		void add_nums(num_span_struct input_nums, double min_value, double max_value); //adds valid numbers into histogram, range is extended if needed
+		std::vector<long long> calc_interval_counter(IntervalManager* intervalManager); //distributes fine bins into intervals defined by interval manager
+};
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "cl_defines.h"
+#include "BlockIndex.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include "const.h"
+
+/*
+Constructor expects file for which index is kept and size of one block. Name of sidecar file is name of indexed file + BLOCK_INDEX_FILE_SUFFIX.
+FileHelper* fileHelper = contains functions regarding to files
+size_t chunk_size = count of doubles in one block (index is valid only for the same chunk size)
+*/
+BlockIndex::BlockIndex(FileHelper* fileHelper, size_t chunk_size)
+{
+	this->fileHelper = fileHelper;
+	this->chunk_size = chunk_size;
+	this->index_file_name = fileHelper->get_file_name() + BLOCK_INDEX_FILE_SUFFIX;
+
+	this->valid_block_count = 0;
+	this->complete = false;
+	this->moments_valid = false;
+	this->avg = 0;
+	this->std_dev = 0;
+}
+
+/*
+Calculates hash of sampled parts of indexed file - beginning, end and BLOCK_INDEX_SAMPLE_COUNT evenly spaced parts (each BLOCK_INDEX_SAMPLE_NUMS doubles). Size of file is part of the hash.
+Hashing whole file would cost as much as the first round itself, samples detect replaced / rewritten files.
+uintmax_t file_size = size of file (in bytes) which should be covered - allows to check whether beginning of appended file is the same
+return = hash of sampled parts
+*/
+uint64_t BlockIndex::calc_sample_hash(uintmax_t file_size)
+{
+	uint64_t hash = FileHelper::calc_hash(&file_size, sizeof(file_size), FNV_HASH_OFFSET);
+	uintmax_t num_count = file_size / sizeof(double);
+	FILE* sampled_file = fopen(this->fileHelper->get_file_name().c_str(), FILE_READ_MODE); //own handle, input file may be opened / mapped by caller
+	if (num_count == 0 || sampled_file == NULL) {
+		if (sampled_file != NULL) {
+			fclose(sampled_file);
+		}
+		return hash;
+	}
+
+	std::vector<double> sample_nums(BLOCK_INDEX_SAMPLE_NUMS);
+	for (int i = 0; i <= BLOCK_INDEX_SAMPLE_COUNT + 1; i++) { //first part, evenly spaced parts, last part
+		uintmax_t sample_start = (num_count * i) / (BLOCK_INDEX_SAMPLE_COUNT + 1);
+		if (i == BLOCK_INDEX_SAMPLE_COUNT + 1) { //last part ends at the end of covered size
+			sample_start = num_count - std::min<uintmax_t>(num_count, BLOCK_INDEX_SAMPLE_NUMS);
+		}
+		size_t sample_count = static_cast<size_t>(std::min<uintmax_t>(BLOCK_INDEX_SAMPLE_NUMS, num_count - sample_start));
+
+#ifdef _WIN32
+		_fseeki64(sampled_file, static_cast<long long>(sample_start * sizeof(double)), SEEK_SET);
+#else
+		fseeko(sampled_file, static_cast<off_t>(sample_start * sizeof(double)), SEEK_SET);
+#endif
+		size_t read_count = fread(sample_nums.data(), sizeof(double), sample_count, sampled_file);
+		hash = FileHelper::calc_hash(sample_nums.data(), read_count * sizeof(double), hash);
+	}
+
+	fclose(sampled_file);
+	return hash;
+}
+
+/*
+Loads sidecar file. Index is used when it was created using the same chunk size and sampled parts of file are unchanged:
+- file size + modification time are the same => index complete, first round can be skipped
+- file is larger (data appended) and beginning of file matches => only blocks after the last full indexed block have to be read
+In other cases index is ignored and rebuilt during first round.
+return = true if at least part of index can be used, else false
+*/
+bool BlockIndex::load_index()
+{
+	FILE* index_file = fopen(this->index_file_name.c_str(), FILE_READ_MODE);
+	if (index_file == NULL) { //no index yet, will be created
+		return false;
+	}
+
+	char magic[sizeof(BLOCK_INDEX_MAGIC)] = {};
+	uint64_t indexed_size = 0, indexed_chunk_size = 0, indexed_hash = 0, block_count = 0;
+	long long indexed_mtime = 0;
+	int moments_flag = 0;
+	double indexed_avg = 0, indexed_std_dev = 0;
+
+	bool header_ok = fread(magic, sizeof(magic), 1, index_file) == 1 && memcmp(magic, BLOCK_INDEX_MAGIC, sizeof(magic)) == 0
+		&& fread(&indexed_size, sizeof(indexed_size), 1, index_file) == 1
+		&& fread(&indexed_mtime, sizeof(indexed_mtime), 1, index_file) == 1
+		&& fread(&indexed_hash, sizeof(indexed_hash), 1, index_file) == 1
+		&& fread(&indexed_chunk_size, sizeof(indexed_chunk_size), 1, index_file) == 1
+		&& fread(&block_count, sizeof(block_count), 1, index_file) == 1
+		&& fread(&moments_flag, sizeof(moments_flag), 1, index_file) == 1
+		&& fread(&indexed_avg, sizeof(indexed_avg), 1, index_file) == 1
+		&& fread(&indexed_std_dev, sizeof(indexed_std_dev), 1, index_file) == 1;
+
+	std::vector<block_stats_struct> indexed_blocks;
+	if (header_ok) {
+		indexed_blocks.resize(static_cast<size_t>(block_count));
+		for (size_t i = 0; i < indexed_blocks.size() && header_ok; i++) {
+			block_stats_struct* block = &indexed_blocks[i];
+			int flags = 0;
+			header_ok = fread(&block->min_value, sizeof(block->min_value), 1, index_file) == 1
+				&& fread(&block->max_value, sizeof(block->max_value), 1, index_file) == 1
+				&& fread(&block->count, sizeof(block->count), 1, index_file) == 1
+				&& fread(&flags, sizeof(flags), 1, index_file) == 1;
+			block->dec_point_num = (flags & 1) != 0;
+			block->negative_num = (flags & 2) != 0;
+		}
+	}
+	fclose(index_file);
+
+	if (!header_ok || indexed_chunk_size != this->chunk_size) {
+		std::cout << "Block index " << this->index_file_name << " is not valid for current settings, rebuilding." << std::endl;
+		return false;
+	}
+
+	uintmax_t file_size = this->fileHelper->deter_file_size();
+	if (indexed_size > file_size || this->calc_sample_hash(indexed_size) != indexed_hash) { //file shrinked / changed
+		std::cout << "Block index " << this->index_file_name << " does not match file content, rebuilding." << std::endl;
+		return false;
+	}
+
+	if (indexed_size == file_size && indexed_mtime == this->fileHelper->deter_file_mtime()) { //unchanged file
+		this->blocks = indexed_blocks;
+		this->valid_block_count = this->blocks.size();
+		this->complete = true;
+		this->moments_valid = moments_flag != 0;
+		this->avg = indexed_avg;
+		this->std_dev = indexed_std_dev;
+		std::cout << "Block index " << this->index_file_name << " loaded, file unchanged." << std::endl;
+		return true;
+	}
+	else if (indexed_size < file_size) { //appended file, last indexed block can be partial -> read again
+		size_t full_block_count = static_cast<size_t>((indexed_size / sizeof(double)) / this->chunk_size);
+		this->blocks = std::vector<block_stats_struct>(indexed_blocks.begin(), indexed_blocks.begin() + std::min<size_t>(full_block_count, indexed_blocks.size()));
+		this->valid_block_count = this->blocks.size();
+		std::cout << "Block index " << this->index_file_name << " loaded, " << this->valid_block_count << " blocks reused, reading appended part only." << std::endl;
+		return true;
+	}
+
+	std::cout << "Block index " << this->index_file_name << " is outdated, rebuilding." << std::endl;
+	return false;
+}
+
+/*
+Writes sidecar file with statistics of all blocks + key of indexed file (size, modification time, hash of sampled parts). Average + standard deviation are written if already known.
+*/
+void BlockIndex::save_index()
+{
+	FILE* index_file = fopen(this->index_file_name.c_str(), "wb");
+	if (index_file == NULL) {
+		std::cout << "WARNING: Block index " << this->index_file_name << " cannot be written." << std::endl;
+		return;
+	}
+
+	uint64_t indexed_size = this->fileHelper->deter_file_size();
+	long long indexed_mtime = this->fileHelper->deter_file_mtime();
+	uint64_t indexed_hash = this->calc_sample_hash(indexed_size);
+	uint64_t indexed_chunk_size = this->chunk_size;
+	uint64_t block_count = this->blocks.size();
+	int moments_flag = this->moments_valid ? 1 : 0;
+
+	fwrite(BLOCK_INDEX_MAGIC, sizeof(BLOCK_INDEX_MAGIC), 1, index_file);
+	fwrite(&indexed_size, sizeof(indexed_size), 1, index_file);
+	fwrite(&indexed_mtime, sizeof(indexed_mtime), 1, index_file);
+	fwrite(&indexed_hash, sizeof(indexed_hash), 1, index_file);
+	fwrite(&indexed_chunk_size, sizeof(indexed_chunk_size), 1, index_file);
+	fwrite(&block_count, sizeof(block_count), 1, index_file);
+	fwrite(&moments_flag, sizeof(moments_flag), 1, index_file);
+	fwrite(&this->avg, sizeof(this->avg), 1, index_file);
+	fwrite(&this->std_dev, sizeof(this->std_dev), 1, index_file);
+
+	for (size_t i = 0; i < this->blocks.size(); i++) {
+		block_stats_struct* block = &this->blocks[i];
+		int flags = (block->dec_point_num ? 1 : 0) | (block->negative_num ? 2 : 0);
+		fwrite(&block->min_value, sizeof(block->min_value), 1, index_file);
+		fwrite(&block->max_value, sizeof(block->max_value), 1, index_file);
+		fwrite(&block->count, sizeof(block->count), 1, index_file);
+		fwrite(&flags, sizeof(flags), 1, index_file);
+	}
+
+	if (fclose(index_file) != 0) {
+		std::cout << "WARNING: Block index " << this->index_file_name << " cannot be written." << std::endl;
+	}
+}
+
+/*
+Stores statistics of blocks read during first round. Statistics are gathered by workers of first round for each chunk (block = chunk), so numbers are not read again. Blocks loaded from index (not read) are kept.
+const std::vector<block_stats_struct>& chunk_stats = statistics of each chunk (index = chunk index), see Farmer::retr_chunk_first_pass_stats
+*/
+void BlockIndex::set_read_blocks(const std::vector<block_stats_struct>& chunk_stats)
+{
+	if (this->blocks.size() < chunk_stats.size()) {
+		this->blocks.resize(chunk_stats.size());
+	}
+	for (size_t i = this->valid_block_count; i < chunk_stats.size(); i++) {
+		this->blocks[i] = chunk_stats[i];
+	}
+	this->moments_valid = false; //blocks changed, moments from previous run not valid anymore
+}
+
+/*
+Sets results of first round of algorithm (min, max, count of valid numbers, decimal point / negative number present) using statistics of all blocks.
+DecisionDist* decisionDist = functions which help to decide which distribution is closest
+*/
+void BlockIndex::apply_first_pass(DecisionDist* decisionDist)
+{
+	block_stats_struct total;
+	for (size_t i = 0; i < this->blocks.size(); i++) {
+		if (this->blocks[i].count == 0) { //no valid number in block, min / max not defined
+			continue;
+		}
+		total.min_value = std::min(total.min_value, this->blocks[i].min_value);
+		total.max_value = std::max(total.max_value, this->blocks[i].max_value);
+		total.count += this->blocks[i].count;
+		total.dec_point_num |= this->blocks[i].dec_point_num;
+		total.negative_num |= this->blocks[i].negative_num;
+	}
+
+	decisionDist->set_min_value(total.min_value);
+	decisionDist->set_max_value(total.max_value);
+	decisionDist->set_count(total.count);
+	decisionDist->set_dec_point_num(total.dec_point_num);
+	decisionDist->set_negative_num(total.negative_num);
+}
+
+/*
+Stores final average + standard deviation of dataset, they are written to sidecar file on next save.
+double avg = average of dataset
+double std_dev = standard deviation of dataset
+*/
+void BlockIndex::set_moments(double avg, double std_dev)
+{
+	this->avg = avg;
+	this->std_dev = std_dev;
+	this->moments_valid = true;
+	this->complete = true;
+}
+
+/*
+Getter for valid_block_count variable.
+*/
+size_t BlockIndex::get_valid_block_count()
+{
+	return this->valid_block_count;
+}
+
+/*
+Getter for complete variable.
+*/
+bool BlockIndex::is_complete()
+{
+	return this->complete;
+}
+
+/*
+Getter for moments_valid variable.
+*/
+bool BlockIndex::has_moments()
+{
+	return this->moments_valid;
+}
+
+/*
+Getter for avg variable.
+*/
+double BlockIndex::get_avg()
+{
+	return this->avg;
+}
+
+/*
+Getter for std_dev variable.
+*/
+double BlockIndex::get_std_dev()
+{
+	return this->std_dev;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "Structures.h"
+#include "FileHelper.h"
+#include "DecisionDist.h"
+
+//sidecar file with statistics of each file block (chunk) from first round of algorithm; allows to skip first round when the same file is processed again
+class BlockIndex
+{
+	private:
+		//constructor variables - START
+		FileHelper* fileHelper; //indexed file
+		size_t chunk_size; //count of doubles in one block (same as chunk read from file)
+		//constructor variables - END
+
+		std::string index_file_name; //name of sidecar file
+		std::vector<block_stats_struct> blocks; //statistics of each block
+		size_t valid_block_count; //count of blocks loaded from index which do not have to be read again
+		bool complete; //index covers whole file, first round can be skipped
+		bool moments_valid; //average + standard deviation of whole file are known from previous run
+		double avg; //average of dataset (previous run)
+		double std_dev; //standard deviation of dataset (previous run)
+
+		uint64_t calc_sample_hash(uintmax_t file_size); //hashes sampled parts of file up to given size
+
+	public:
+		BlockIndex(FileHelper* fileHelper, size_t chunk_size); //constructor expects indexed file + size of block
+		bool load_index(); //loads sidecar file if it exists and matches indexed file
+		void save_index(); //writes sidecar file
+		void set_read_blocks(const std::vector<block_stats_struct>& chunk_stats); //stores statistics of blocks (chunks) read during first round
+		void apply_first_pass(DecisionDist* decisionDist); //sets results of first round using statistics of all blocks
+		void set_moments(double avg, double std_dev); //stores final average + standard deviation
+		size_t get_valid_block_count(); //count of blocks which do not have to be read
+		bool is_complete(); //true if first round can be skipped
+		bool has_moments(); //true if average + standard deviation are known from previous run
+		double get_avg(); //average from previous run
+		double get_std_dev(); //standard deviation from previous run
+};
\ No newline at end of file
@@ -6,11 +6,11 @@
 
 /*
 Constructor requires total count of valid numbers in dataset which are then used for calculations regarding to chi-square goodness of fit test.
-long count = total count of VALID numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
+long long count = total count of VALID numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
 double avg = average of dataset (required for Poisson calculation)
 int interval_count = count of available intervals into which are number sorted
 */
-ChiSquareManager::ChiSquareManager(long count, double avg, int interval_count)
+ChiSquareManager::ChiSquareManager(long long count, double avg, int interval_count)
 {
 	this->count = count;
 	this->avg = avg;
@@ -41,10 +41,10 @@ double ChiSquareManager::calc_expected_freq(double expec_prob)
 
 /*
 Calculates formula specific for chi-square goodness of fit test. Formula is defined as: (ni - expectFreq) ^ 2 / expectFreq.
-int ni = number of occurence for specific interval
+long long ni = number of occurence for specific interval
 double expect_freq = expected frequency for given interval
 */
-double ChiSquareManager::calc_chi_square_formula(int ni, double expect_freq)
+double ChiSquareManager::calc_chi_square_formula(long long ni, double expect_freq)
 {
 	return ((ni - expect_freq) * (ni - expect_freq)) / expect_freq;
 }
@@ -137,10 +137,10 @@ std::vector<double> ChiSquareManager::calc_expected_freq_bulk(std::vector<double
 /*
 Function does bulk calculation chi-square goodness of fit test, ie. calculates chi-square formula for every given interval.
 Returns array with solved chi-square formula for all intervals, size is the same as input arrays.
-std::vector<int> ni = array with number of occurence for each interval (indexing is same for both input arrays)
+std::vector<long long> ni = array with number of occurence for each interval (indexing is same for both input arrays)
 std::vector<double> expect_freq = array with expected frequency for each interval (indexing is same for both input arrays)
 */
-std::vector<double> ChiSquareManager::calc_chi_square_formula_bulk(std::vector<int> ni, std::vector<double> expect_freq)
+std::vector<double> ChiSquareManager::calc_chi_square_formula_bulk(std::vector<long long> ni, std::vector<double> expect_freq)
 {
 	std::vector<double> chiSquareFormulas(this->interval_count); //array with calculated chi-square formulas for every interval
 
@@ -428,7 +428,7 @@ chi_part_res_struct* exp_freq_res = pointer to structure with expected frequency
 */
 chi_part_res_struct* ChiSquareManager::calc_chi_formula_all_valid_dist(IntervalManager* intervalManager, chi_part_res_struct* exp_freq_res)
 {
-	std::vector<int> interval_counter = intervalManager->get_interval_counter(); //get array with counter for each interval, mandatory for chi-square formula calc
+	std::vector<long long> interval_counter = intervalManager->get_interval_counter(); //get array with counter for each interval, mandatory for chi-square formula calc
 
 	//retrieve expected frequency results from input structure
 	int exp_freq_arr_size = exp_freq_res->res_arr_size;
@@ -480,7 +480,7 @@ chi_part_res_struct* ChiSquareManager::calc_distrib_func(IntervalManager* interv
 	double max_value_dataset = decisionDist->get_max_value();
 	double avg_dataset = decisionDist->get_avg();
 	double std_dev_dataset = decisionDist->get_std_dev();
-	long count_dataset = decisionDist->get_count();
+	long long count_dataset = decisionDist->get_count();
 
 	//create struct which will contain results for all relevant distribution functions
 	chi_part_res_struct* distrib_func_res = new chi_part_res_struct;
@@ -521,13 +521,13 @@ chi_part_res_struct* ChiSquareManager::calc_distrib_func(IntervalManager* interv
 			PoissonDistrib* poissonDistrib = new PoissonDistrib(avg_dataset);
 			std::vector<double> poisson_res_arr(interval_count); //array for results of poisson distribution function
 
-			int last_up_int = -1; //init - Poisson cannot ever be -1
-			int bound_low_int; //integer lower boundary of interval
-			int bound_up_int; //integer upper boundary interval
+			long long last_up_int = -1; //init - Poisson cannot ever be -1
+			long long bound_low_int; //integer lower boundary of interval
+			long long bound_up_int; //integer upper boundary interval
 			for (int i = 0; i < loop_end; i++) { //calculate Poisson for each interval
 				//interval boundaries for Poisson must be integer
-				bound_low_int = (int)interval_bound_low[i];
-				bound_up_int = (int)interval_bound_up[i];
+				bound_low_int = (long long)interval_bound_low[i];
+				bound_up_int = (long long)interval_bound_up[i];
 
 				if (last_up_int == bound_low_int) { //upper boundary of last processed integer is equal with following lower boundary, increase by 1
 					bound_low_int += 1;
@@ -13,21 +13,21 @@ class ChiSquareManager
 {
 private:
 	//constructor variables - START
-	long count; //total count of VALID numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
+	long long count; //total count of VALID numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
 	double avg; //average of dataset
 	int interval_count; //total count of available intervals
 	//constructor variables - END
 
 public:
-	ChiSquareManager(long count, double avg, int interval_count); //constructor expects count of valid nums, average and count of avail. intervals into which numbers are sorted
+	ChiSquareManager(long long count, double avg, int interval_count); //constructor expects count of valid nums, average and count of avail. intervals into which numbers are sorted
 	double calc_expected_prob(double d_func_res_prev, double d_func_res_next); //calculates expected probability for given interval
 	double calc_expected_freq(double expec_prob); //calculates expected frequency for given interval
-	double calc_chi_square_formula(int ni, double expect_freq); //calculates formula specific for chi-square goodness of fit test
+	double calc_chi_square_formula(long long ni, double expect_freq); //calculates formula specific for chi-square goodness of fit test
 	double calc_test_crit(std::vector<double> calc_chi_interval); //sums calculated chi-square formulas for all of the intervals and returns result
 
 	std::vector<double> calc_expected_prob_bulk(std::vector<double> d_func_res); //bulk calculation of expected probabilities
 	std::vector<double> calc_expected_freq_bulk(std::vector<double> expec_prob_res); //calc expected frequencies for more intervals
-	std::vector<double> calc_chi_square_formula_bulk(std::vector<int> ni, std::vector<double> expect_freq); //calculates chi-square formula for every given interval
+	std::vector<double> calc_chi_square_formula_bulk(std::vector<long long> ni, std::vector<double> expect_freq); //calculates chi-square formula for every given interval
 	chi_win_res_struct* pick_lowest_test_crit(chi_crit_res_struct* chi_test_crit_res); //picks distribution with lowest calculated test criterium
 	void print_chi_crit_res(chi_crit_res_struct* chi_crit_res); //prints all results from chi_crit_res structure
 	void print_chi_win_res(chi_win_res_struct* chi_win_res); //prints information regarding to winning distribution
@@ -0,0 +1,246 @@
+#include "cl_defines.h"
+#include "ChunkReader.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+
+/*
+Constructor takes file from which chunks are read and parameters of reading.
+FileHelper* fileHelper = contains functions regarding to files
+size_t chunk_size = count of doubles in one chunk
+int queue_depth = count of chunks which are read ahead by reader threads; if 0, chunks are read on demand by calling thread
+int read_thread_count = count of reader threads, each one reads different chunk (byte range) of file at the same time
+*/
+ChunkReader::ChunkReader(FileHelper* fileHelper, size_t chunk_size, int queue_depth, int read_thread_count)
+{
+	this->fileHelper = fileHelper;
+	this->chunk_size = chunk_size;
+	this->queue_depth = queue_depth;
+	this->read_thread_count = read_thread_count;
+
+	this->file_num_count = 0;
+	this->chunk_count = 0;
+	this->next_chunk_index = 0;
+	this->first_chunk_index = 0;
+	this->next_read_chunk_index = 0;
+	this->running_reader_count = 0;
+	this->consumed_buf = -1;
+	this->reader_done = false;
+	this->reader_stop = false;
+	this->read_failed = false;
+}
+
+/*
+Destructor frees ring of chunk buffers.
+*/
+ChunkReader::~ChunkReader()
+{
+	for (size_t i = 0; i < this->chunk_bufs.size(); i++) {
+		this->fileHelper->free_read_buffer(this->chunk_bufs[i]);
+	}
+}
+
+/*
+Sets chunk from which reading starts on next start_read call. Chunks before it are skipped (their results are known from elsewhere, eg. block index).
+size_t first_chunk_index = index of first chunk to read
+*/
+void ChunkReader::set_first_chunk(size_t first_chunk_index)
+{
+	this->first_chunk_index = first_chunk_index;
+}
+
+/*
+Opens file and prepares reading from its beginning. If prefetching is enabled (queue depth > 0, file not memory mapped), ring of chunk buffers is allocated and reader threads are started.
+Ring contains queue_depth + read_thread_count buffers - one is processed by consumer, one is being filled by each reader thread, others are read ahead.
+return = true if file opened successfully, else false (file cannot be opened / not enough memory for ring of buffers)
+*/
+bool ChunkReader::start_read()
+{
+	if (this->fileHelper->open_file_read() == false) {
+		std::cout << "ERROR: File " << this->fileHelper->get_file_name() << " cannot be opened for reading." << std::endl;
+		return false;
+	}
+
+	if (this->fileHelper->is_stream_input()) { //size of stream not known, chunks are read until end of stream (shorter chunk)
+		this->file_num_count = UINTMAX_MAX;
+		this->chunk_count = SIZE_MAX;
+	}
+	else {
+		this->file_num_count = this->fileHelper->deter_file_size() / sizeof(double);
+		this->chunk_count = static_cast<size_t>((this->file_num_count + this->chunk_size - 1) / this->chunk_size);
+	}
+	this->next_chunk_index = this->first_chunk_index;
+	this->next_read_chunk_index = this->first_chunk_index;
+	this->consumed_buf = -1;
+	this->reader_done = false;
+	this->reader_stop = false;
+	this->read_failed = false;
+
+	if (this->queue_depth > 0 && !this->fileHelper->is_file_mapped()) { //mapped file is prefetched by kernel (madvise), no thread needed
+		size_t buf_count = static_cast<size_t>(this->queue_depth) + this->read_thread_count;
+		if (this->chunk_bufs.size() != buf_count) { //allocate once, same buffers used for both passes
+			for (size_t i = 0; i < buf_count; i++) {
+				double* chunk_buf = this->fileHelper->alloc_read_buffer(this->chunk_size); //aligned, direct I/O can read into buffer without copy
+				if (chunk_buf == NULL) { //buffers allocated so far are freed, next start_read tries again
+					std::cout << "ERROR: Buffers for reading of file " << this->fileHelper->get_file_name() << " could not be allocated (not enough memory)." << std::endl;
+					for (size_t j = 0; j < this->chunk_bufs.size(); j++) {
+						this->fileHelper->free_read_buffer(this->chunk_bufs[j]);
+					}
+					this->chunk_bufs.clear();
+					this->fileHelper->close_file_read();
+					return false;
+				}
+				this->chunk_bufs.push_back(chunk_buf);
+			}
+		}
+
+		this->free_bufs.clear();
+		this->filled_bufs.clear();
+		for (size_t i = 0; i < this->chunk_bufs.size(); i++) {
+			this->free_bufs.push_back(i);
+		}
+		this->running_reader_count = this->read_thread_count;
+		for (int i = 0; i < this->read_thread_count; i++) {
+			this->reader_threads.push_back(std::thread(&ChunkReader::read_loop, this));
+		}
+	}
+	return true;
+}
+
+/*
+Action performed by each reader thread. Takes next unread chunk together with free buffer from ring, reads it (pread, does not share file position with other threads) and passes it to consumer. Waits if no buffer is free.
+Chunks read by different threads are finished in any order - results of both rounds do not depend on order of chunks.
+*/
+void ChunkReader::read_loop()
+{
+	while (true) {
+		int buf_index;
+		size_t chunk_index;
+		{
+			std::unique_lock<std::mutex> uniq_mutex(this->reader_mutex);
+			this->reader_cond.wait(uniq_mutex, [this] { return this->reader_stop || this->next_read_chunk_index >= this->chunk_count || !this->free_bufs.empty(); });
+			if (this->reader_stop || this->next_read_chunk_index >= this->chunk_count) {
+				break;
+			}
+			buf_index = this->free_bufs.front();
+			this->free_bufs.pop_front();
+			chunk_index = this->next_read_chunk_index;
+			this->next_read_chunk_index++;
+		}
+
+		uintmax_t chunk_start = static_cast<uintmax_t>(chunk_index) * this->chunk_size;
+		size_t chunk_nums = static_cast<size_t>(std::min<uintmax_t>(this->chunk_size, this->file_num_count - chunk_start)); //last chunk can be shorter
+		size_t read_nums = this->fileHelper->read_part_file_into(chunk_start * sizeof(double), chunk_nums, this->chunk_bufs[buf_index]);
+
+		num_span_struct chunk;
+		chunk.nums = this->chunk_bufs[buf_index];
+		chunk.size = read_nums;
+		chunk.chunk_index = chunk_index;
+
+		std::unique_lock<std::mutex> uniq_mutex(this->reader_mutex);
+		if (read_nums != chunk_nums && !this->fileHelper->is_stream_input()) { //read error / file truncated, stop all reader threads, incomplete chunk is not passed to consumer
+			std::cout << "ERROR: Reading of file " << this->fileHelper->get_file_name() << " failed at offset " << chunk_start * sizeof(double) << "." << std::endl;
+			this->free_bufs.push_back(buf_index);
+			this->read_failed = true;
+			this->reader_stop = true;
+			this->reader_cond.notify_all();
+			break;
+		}
+		this->filled_bufs.push_back(std::make_pair(buf_index, chunk));
+		this->reader_cond.notify_all();
+		if (read_nums != chunk_nums) { //end of stream reached (stream is read by one thread only)
+			this->chunk_count = chunk_index + 1;
+			break;
+		}
+	}
+
+	std::unique_lock<std::mutex> uniq_mutex(this->reader_mutex);
+	this->running_reader_count--;
+	if (this->running_reader_count == 0) { //last reader thread finished
+		this->reader_done = true;
+	}
+	this->reader_cond.notify_all();
+}
+
+/*
+Gets next chunk of file. Chunk view is valid until next call of the function (buffer of previous chunk is returned to reader thread).
+num_span_struct* chunk = output, view of numbers in chunk
+return = true if chunk retrieved, false if whole file was already read or reading failed (see stop_read)
+*/
+bool ChunkReader::next_chunk(num_span_struct* chunk)
+{
+	if (this->reader_threads.empty()) { //no reader thread, read on demand
+		if (this->next_chunk_index >= this->chunk_count) {
+			return false;
+		}
+
+		uintmax_t chunk_start = static_cast<uintmax_t>(this->next_chunk_index) * this->chunk_size;
+		size_t chunk_nums = static_cast<size_t>(std::min<uintmax_t>(this->chunk_size, this->file_num_count - chunk_start));
+		if (this->next_chunk_index + this->queue_depth < this->chunk_count) { //tell kernel which part of file will be needed (mapped file only)
+			this->fileHelper->prefetch_part_file((chunk_start + this->chunk_size * this->queue_depth) * sizeof(double), this->chunk_size);
+		}
+
+		*chunk = this->fileHelper->get_part_file(chunk_start * sizeof(double), chunk_nums);
+		chunk->chunk_index = this->next_chunk_index;
+		if (chunk->size != chunk_nums && this->fileHelper->is_stream_input()) { //end of stream reached, this is the last chunk
+			this->chunk_count = this->next_chunk_index + 1;
+		}
+		else if (chunk->size != chunk_nums) { //read error / file truncated
+			std::cout << "ERROR: Reading of file " << this->fileHelper->get_file_name() << " failed at offset " << chunk_start * sizeof(double) << "." << std::endl;
+			this->read_failed = true;
+			this->chunk_count = this->next_chunk_index;
+			return false;
+		}
+		this->next_chunk_index++;
+		return true;
+	}
+
+	std::unique_lock<std::mutex> uniq_mutex(this->reader_mutex);
+	if (this->consumed_buf != -1) { //previous chunk processed, buffer can be reused
+		this->free_bufs.push_back(this->consumed_buf);
+		this->consumed_buf = -1;
+		this->reader_cond.notify_all();
+	}
+
+	this->reader_cond.wait(uniq_mutex, [this] { return this->reader_done || this->read_failed || !this->filled_bufs.empty(); });
+	if (this->read_failed || this->filled_bufs.empty()) { //reading failed / reader finished, nothing left
+		return false;
+	}
+
+	std::pair<int, num_span_struct> filled_buf = this->filled_bufs.front();
+	this->filled_bufs.pop_front();
+	this->consumed_buf = filled_buf.first;
+
+	*chunk = filled_buf.second;
+	return true;
+}
+
+/*
+Stops reading of file. Reader threads (if running) are stopped and joined, file is closed.
+return = true if all requested chunks were read, false if reading failed (results of pass are incomplete)
+*/
+bool ChunkReader::stop_read()
+{
+	if (!this->reader_threads.empty()) {
+		{
+			std::unique_lock<std::mutex> uniq_mutex(this->reader_mutex);
+			this->reader_stop = true;
+			this->reader_cond.notify_all();
+		}
+		for (size_t i = 0; i < this->reader_threads.size(); i++) {
+			this->reader_threads[i].join();
+		}
+		this->reader_threads.clear();
+	}
+
+	this->fileHelper->close_file_read();
+	return !this->read_failed;
+}
+
+/*
+Getter for chunk_size variable.
+*/
+size_t ChunkReader::get_chunk_size()
+{
+	return this->chunk_size;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "FileHelper.h"
+#include "Structures.h"
+
+//reads input file chunk by chunk, optionally using reader thread which keeps chunks prefetched ahead of computation
+class ChunkReader
+{
+	private:
+		//constructor variables - START
+		FileHelper* fileHelper; //file from which chunks are read
+		size_t chunk_size; //count of doubles in one chunk
+		int queue_depth; //count of chunks which can be read ahead by reader thread (0 = read on demand, no thread)
+		int read_thread_count; //count of reader threads issuing reads concurrently
+		//constructor variables - END
+
+		uintmax_t file_num_count; //count of doubles present in file
+		size_t chunk_count; //count of chunks in file
+		size_t next_chunk_index; //index of chunk which will be returned next (no reader thread)
+		size_t first_chunk_index; //index of chunk from which reading starts
+		size_t next_read_chunk_index; //index of chunk which will be read next by one of reader threads
+		int running_reader_count; //count of reader threads which did not finish yet
+
+		std::vector<double*> chunk_bufs; //ring of buffers reused for all chunks (reader threads), aligned for direct I/O
+		std::deque<int> free_bufs; //indexes of buffers which can be filled by reader thread
+		std::deque<std::pair<int, num_span_struct>> filled_bufs; //buffers filled by reader threads (buffer index + view of read doubles), not necessarily in file order
+		int consumed_buf; //buffer which is currently processed by consumer (-1 if none)
+		bool reader_done; //all reader threads read whole file / stopped
+		bool reader_stop; //consumer requested stop of reader threads (or read failed)
+		bool read_failed; //part of file could not be read (read error / file truncated), results would be incomplete
+		std::vector<std::thread> reader_threads; //threads which read chunks ahead
+		std::mutex reader_mutex; //guards buffer queues
+		std::condition_variable reader_cond; //signals change of buffer queues
+
+		void read_loop(); //action performed by reader thread
+
+	public:
+		ChunkReader(FileHelper* fileHelper, size_t chunk_size, int queue_depth, int read_thread_count); //constructor expects file + chunk size + count of prefetched chunks + count of reader threads
+		~ChunkReader(); //frees ring of chunk buffers
+		void set_first_chunk(size_t first_chunk_index); //sets chunk from which following reads start (skips beginning of file)
+		bool start_read(); //opens file and starts reading (reader thread)
+		bool next_chunk(num_span_struct* chunk); //gets next chunk of file, false if whole file read / read failed
+		bool stop_read(); //stops reader threads, closes file, false if read failed
+		size_t get_chunk_size(); //count of doubles in one chunk
+};
\ No newline at end of file
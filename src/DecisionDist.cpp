@@ -2,12 +2,13 @@
 #include <iostream>
 #include "DecisionDist.h"
 #include "cl_defines.h"
+#include "StatsKernel.h"
 
 /*
 Increase total dataset count only if std::fpclassify returns FP_NORMAL or FP_ZERO for given number.
-int count_to_add = valid number count to add
+long long count_to_add = valid number count to add
 */
-void DecisionDist::update_count(int count_to_add)
+void DecisionDist::update_count(long long count_to_add)
 {
 	this->count += count_to_add;
 }
@@ -52,6 +53,42 @@ void DecisionDist::update_avg_var(double num) {
 	welford_counter++;
 }
 
+/*
+Calculates partial moments (count, mean, M2) of one chunk in parallel and stores them by index of chunk. Normalization is applied in the same way as in update_avg_var.
+Replaces calling update_avg_var for each number of the chunk.
+num_span_struct valid_nums = valid numbers of chunk
+*/
+void DecisionDist::update_avg_var_chunk(num_span_struct valid_nums) {
+	if (this->chunk_moments.size() <= valid_nums.chunk_index) {
+		this->chunk_moments.resize(valid_nums.chunk_index + 1);
+	}
+	this->chunk_moments[valid_nums.chunk_index] = StatsKernel::calc_moments(valid_nums.nums, valid_nums.size, get_normalize_val());
+}
+
+/*
+Merges partial moments of all chunks (in order of chunks in file) into average + variance of dataset. Order of merging does not depend on order in which chunks were processed, so result is the same across runs.
+Moments of processed chunks are cleared.
+*/
+void DecisionDist::merge_chunk_moments() {
+	moments_struct moments;
+	for (size_t i = 0; i < this->chunk_moments.size(); i++) {
+		StatsKernel::merge_moments(&moments, this->chunk_moments[i]);
+	}
+	this->chunk_moments.clear();
+	set_moments(moments);
+}
+
+/*
+Sets average + variance of dataset from its moments (calculated by chunks / devices). Values are normalized in the same way as in update_avg_var.
+const moments_struct& moments = count, mean, M2 of whole dataset
+*/
+void DecisionDist::set_moments(const moments_struct& moments) {
+	this->avg = moments.mean;
+	this->m_sum = moments.m2;
+	this->variance = moments.count > 0 ? moments.m2 / moments.count : 0;
+	this->welford_counter = moments.count;
+}
+
 /*
 Calculates standard deviation of dataset. Variance must be determined before calculation.
 */
@@ -60,6 +97,14 @@ void DecisionDist::calc_std_dev()
 	this->std_dev = sqrt(this->variance);
 }
 
+/*
+Returns value by which numbers are divided before moments are calculated, 1 if normalization is not active.
+*/
+double DecisionDist::get_normalize_val()
+{
+	return this->normalize ? this->normalize_val : 1;
+}
+
 /*
 Getter for min_value variable.
 */
@@ -95,7 +140,7 @@ double DecisionDist::get_std_dev()
 /*
 Getter for count variable.
 */
-long DecisionDist::get_count()
+long long DecisionDist::get_count()
 {
 	return this->count;
 }
@@ -153,4 +198,24 @@ bool found = value to set
 void DecisionDist::set_negative_num(bool found)
 {
 	this->negative_num = found;
+}
+
+/*
+Setter for count variable.
+long long count = count of valid numbers in dataset
+*/
+void DecisionDist::set_count(long long count)
+{
+	this->count = count;
+}
+
+/*
+Sets final average + standard deviation of dataset, used instead of Welfords algorithm when values are known from previous run (block index).
+double avg = average of dataset
+double std_dev = standard deviation of dataset
+*/
+void DecisionDist::set_avg_std_dev(double avg, double std_dev)
+{
+	this->avg = avg;
+	this->std_dev = std_dev;
 }
\ No newline at end of file
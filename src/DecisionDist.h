@@ -1,4 +1,6 @@
 #pragma once
+#include <vector>
+#include "Structures.h"
 
 //used for making decisions related to closest distribution
 class DecisionDist
@@ -10,7 +12,7 @@ class DecisionDist
 		double min_value; //minimum value found in dataset
 		double max_value; //maximum value found in dataset
 
-		long count; //total count of VALID numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
+		long long count; //total count of VALID numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
 
 		double avg; //average of dataset
 		double variance; //variance of dataset
@@ -18,16 +20,21 @@ class DecisionDist
 		bool normalize; //true if normalization should be applied
 		double normalize_val; //constant which is used for normalization, dividing - usually dataset max
 		double std_dev; //standard deviation of dataset (must be calculated after variance is determined)
-		long welford_counter; //count of numbers processed by welfords algo
+		long long welford_counter; //count of numbers processed by welfords algo
+		std::vector<moments_struct> chunk_moments; //partial moments of each chunk (index = chunk index), merged after whole file is processed
 	public:
-		void update_count(int count_to_add); //increase counter of valid number by given number
+		void update_count(long long count_to_add); //increase counter of valid number by given number
 		void update_avg_var(double num); //update avg + variance using Welfords online algorithm
+		void update_avg_var_chunk(num_span_struct valid_nums); //calculates partial moments of chunk (parallel, vectorized)
+		void merge_chunk_moments(); //merges partial moments of all chunks into avg + variance (Chan's formula)
+		void set_moments(const moments_struct& moments); //sets avg + variance from moments of whole dataset
+		double get_normalize_val(); //value by which numbers are divided before moments are calculated (1 if normalization is not active)
 		void calc_std_dev(); //calculates standard deviance of dataset (variance must be determined before)
 		double get_min_value(); //getter for min_value variable
 		double get_max_value(); //getter for max_value variable.
 		double get_avg(); //getter for dataset average
 		double get_std_dev(); //getter for standard deviation of dataset
-		long get_count(); //getter for count of valid numbers
+		long long get_count(); //getter for count of valid numbers
 		void enable_avg_var_normalization(double dataset_max); //enables normalization using given number
 		void finalize_avg_std_dev_normalization(); //multiplies using number used for normalization
 		void reset_count(); //resets valid number counter
@@ -37,4 +44,6 @@ class DecisionDist
 		void set_max_value(double max_value); //setter for dataset max value
 		void set_dec_point_num(bool found); //setter for dec_point_num variable
 		void set_negative_num(bool found); //setter for negative_num variable
+		void set_count(long long count); //setter for count of valid numbers
+		void set_avg_std_dev(double avg, double std_dev); //sets final average + standard deviation (known from previous run)
 };
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "cl_defines.h"
+#include "DeviceFeeder.h"
+#include <algorithm>
+#include <iostream>
+
+/*
+Constructor prepares host side of ring of input buffers and starts feeder thread. Ring depth is given by count of input buffers allocated for the device.
+cl_dev_stuff_struct* cl_dev = device fed by thread (must stay valid until feeder is destroyed)
+std::mutex* sched_mutex = mutex of scheduler which waits for free device
+std::condition_variable* sched_cond = condition notified each time input buffer of the device may become free
+*/
+DeviceFeeder::DeviceFeeder(cl_dev_stuff_struct* cl_dev, std::mutex* sched_mutex, std::condition_variable* sched_cond)
+{
+	this->cl_dev = cl_dev;
+	this->ring_depth = cl_dev->input_nums_bufs.size();
+	this->sched_mutex = sched_mutex;
+	this->sched_cond = sched_cond;
+
+	this->kernel_events = std::vector<cl::Event>(this->ring_depth);
+	for (size_t i = 0; i < this->ring_depth; i++) { //host memory of all buffers is mapped in advance
+		this->host_nums.push_back(this->map_slot(i, NULL));
+	}
+	this->slot_states.reset(new std::atomic<int>[this->ring_depth]);
+	for (size_t i = 0; i < this->ring_depth; i++) {
+		this->slot_states[i].store(SLOT_FREE);
+	}
+	this->next_slot = 0;
+
+	for (size_t i = 0; i < this->ring_depth; i++) {
+		this->callback_data.push_back(std::make_pair(this, i));
+	}
+	this->slot_num_count = std::vector<size_t>(this->ring_depth, 0);
+	this->slot_enqueue_times = std::vector<std::chrono::steady_clock::time_point>(this->ring_depth);
+	this->last_complete_time = std::chrono::steady_clock::now();
+	this->pending_callbacks = 0;
+	this->throughput.store(0);
+
+	this->tasks = std::vector<cl_feed_task_struct>(this->ring_depth);
+	this->task_head.store(0);
+	this->task_tail.store(0);
+	this->feeder_stop.store(false);
+	this->feeder_thread = std::thread(&DeviceFeeder::feed_loop, this);
+}
+
+/*
+Destructor stops feeder thread and waits until completion callbacks of all enqueued kernels finish (they use the feeder). Tasks which were not taken yet are dropped, mapped buffers are unmapped.
+*/
+DeviceFeeder::~DeviceFeeder()
+{
+	{
+		std::lock_guard<std::mutex> lock_mutex(this->feeder_mutex);
+		this->feeder_stop.store(true);
+	}
+	this->feeder_cond.notify_all();
+	this->feeder_thread.join();
+
+	for (size_t i = 0; i < this->ring_depth; i++) {
+		if (this->slot_states[i].load() == SLOT_ENQUEUED) {
+			this->kernel_events[i].wait();
+		}
+		if (!this->cl_dev->zero_copy) { //pinned staging buffers are mapped all the time
+			this->cl_dev->transfer_queue.enqueueUnmapMemObject(this->cl_dev->pinned_nums_bufs[i], this->host_nums[i]);
+		}
+		else if (this->slot_states[i].load() != SLOT_ENQUEUED) { //input buffer of enqueued task was unmapped by feeder thread
+			this->cl_dev->transfer_queue.enqueueUnmapMemObject(this->cl_dev->input_nums_bufs[i], this->host_nums[i]);
+		}
+	}
+	this->cl_dev->transfer_queue.finish();
+
+	std::unique_lock<std::mutex> uniq_mutex(this->stats_mutex); //runtime may call callback after the event is complete
+	this->callbacks_cond.wait(uniq_mutex, [this] { return this->pending_callbacks == 0; });
+}
+
+/*
+Checks whether next input buffer of ring can be used by new task. Ie. buffer was not used yet or kernel which read it is finished. Called by producer only.
+return = true if task can be submitted without waiting
+*/
+bool DeviceFeeder::has_free_slot()
+{
+	int slot_state = this->slot_states[this->next_slot].load(std::memory_order_acquire);
+	if (slot_state == SLOT_FREE) {
+		return true;
+	}
+	else if (slot_state == SLOT_QUEUED) { //not even enqueued by feeder thread
+		return false;
+	}
+	return this->kernel_events[this->next_slot].getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() <= CL_COMPLETE; //negative status = kernel terminated with error
+}
+
+/*
+Maps host memory of one input buffer for writing. Zero copy device - input buffer itself is mapped (no transfer, device reads the same memory), other devices - pinned staging buffer is mapped (upload is then done by DMA from it).
+size_t slot = index of input buffer
+const std::vector<cl::Event>* wait_events = commands which must complete before mapping (kernel which read the buffer), NULL if none
+return = mapped host memory (capacity of input buffer)
+*/
+double* DeviceFeeder::map_slot(size_t slot, const std::vector<cl::Event>* wait_events)
+{
+	cl::Buffer* map_buf = this->cl_dev->zero_copy ? &this->cl_dev->input_nums_bufs[slot] : &this->cl_dev->pinned_nums_bufs[slot];
+	cl_int map_error = CL_SUCCESS;
+	void* host_ptr = this->cl_dev->transfer_queue.enqueueMapBuffer(*map_buf, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 0, this->cl_dev->input_nums_capacity * sizeof(double), wait_events, NULL, &map_error);
+	if (map_error != CL_SUCCESS) {
+		std::cout << "ERROR: mapping of OpenCL input buffer failed, error code: " << map_error << std::endl;
+	}
+	return static_cast<double*>(host_ptr);
+}
+
+/*
+Reserves next input buffer of ring for new task. If kernel which used the buffer is not finished yet, waits for it (zero copy device - buffer is mapped again once the kernel is done). Called by producer only, reserved buffer must be passed to submit.
+size_t* slot_index = index of reserved input buffer
+return = host memory which should be filled with numbers for the task (at most capacity of input buffer)
+*/
+double* DeviceFeeder::acquire_slot(size_t* slot_index)
+{
+	size_t slot = this->next_slot;
+	this->next_slot = (slot + 1) % this->ring_depth;
+
+	if (this->slot_states[slot].load(std::memory_order_acquire) != SLOT_FREE) { //buffer may still be read by previous task
+		{
+			std::unique_lock<std::mutex> uniq_mutex(this->feeder_mutex); //wait for feeder thread to enqueue it
+			this->feeder_cond.wait(uniq_mutex, [this, slot] { return this->slot_states[slot].load(std::memory_order_acquire) != SLOT_QUEUED; });
+		}
+		if (this->cl_dev->zero_copy) { //buffer was unmapped for the kernel, map it back after kernel completes
+			std::vector<cl::Event> kernel_wait(1, this->kernel_events[slot]);
+			this->host_nums[slot] = this->map_slot(slot, &kernel_wait);
+		}
+		else {
+			this->kernel_events[slot].wait();
+		}
+	}
+	this->slot_states[slot].store(SLOT_QUEUED, std::memory_order_relaxed);
+
+	*slot_index = slot;
+	return this->host_nums[slot];
+}
+
+/*
+Passes task to feeder thread. Each queued task holds one reserved input buffer, so queue (capacity = ring depth) never overflows.
+const cl_feed_task_struct& task = task with reserved input buffer filled with numbers
+*/
+void DeviceFeeder::submit(const cl_feed_task_struct& task)
+{
+	size_t tail = this->task_tail.load(std::memory_order_relaxed);
+	this->tasks[tail % this->ring_depth] = task;
+	this->task_tail.store(tail + 1, std::memory_order_release);
+
+	{
+		std::lock_guard<std::mutex> lock_mutex(this->feeder_mutex); //feeder thread cannot miss wake up between check + sleep
+	}
+	this->feeder_cond.notify_all();
+}
+
+/*
+Waits until feeder thread enqueued all submitted tasks and device completed them. Called by producer only.
+*/
+void DeviceFeeder::finish()
+{
+	{
+		std::unique_lock<std::mutex> uniq_mutex(this->feeder_mutex);
+		this->feeder_cond.wait(uniq_mutex, [this] { return this->task_head.load(std::memory_order_acquire) == this->task_tail.load(std::memory_order_acquire); });
+	}
+	this->cl_dev->dev_queue.finish();
+}
+
+/*
+Action performed by feeder thread. Takes tasks from queue, uploads numbers into input buffer (non-blocking, transfer queue) and enqueues kernel waiting for the upload (kernel queue).
+If task has result buffers, reads of results + their reset are enqueued behind the kernel (host memory is filled once device queue finishes).
+Upload of next chunk thus runs while kernel processes previous one. Kernel arguments are set only by this thread.
+*/
+void DeviceFeeder::feed_loop()
+{
+	while (true) {
+		size_t head = this->task_head.load(std::memory_order_relaxed);
+		if (head == this->task_tail.load(std::memory_order_acquire)) { //queue empty, sleep until producer submits task
+			std::unique_lock<std::mutex> uniq_mutex(this->feeder_mutex);
+			this->feeder_cond.wait(uniq_mutex, [this, head] { return this->feeder_stop.load() || head != this->task_tail.load(std::memory_order_acquire); });
+			if (this->feeder_stop.load()) {
+				break;
+			}
+		}
+
+		const cl_feed_task_struct& task = this->tasks[head % this->ring_depth];
+		cl::Buffer* input_buf = &this->cl_dev->input_nums_bufs[task.ring_index];
+		cl_ulong input_nums_size = task.num_count; //64-bit size in kernels
+
+		std::vector<cl::Event> upload_events(1);
+		if (this->cl_dev->zero_copy) { //numbers written directly into input buffer, unmap hands it over to device
+			this->cl_dev->transfer_queue.enqueueUnmapMemObject(*input_buf, this->host_nums[task.ring_index], NULL, &upload_events[0]);
+		}
+		else { //upload from pinned staging buffer, pinned memory stays mapped (host does not touch it until kernel completes)
+			this->cl_dev->transfer_queue.enqueueWriteBuffer(*input_buf, CL_FALSE, 0, task.num_count * sizeof(double), this->host_nums[task.ring_index], NULL, &upload_events[0]);
+		}
+
+		task.kernel->setArg(task.input_buf_arg, *input_buf);
+		task.kernel->setArg(task.input_size_arg, input_nums_size);
+		if (task.interval_args) {
+			task.kernel->setArg(4, task.interval_size_recip);
+			task.kernel->setArg(5, task.min_value_scaled);
+		}
+		cl::NDRange local_range = task.local_size == 0 ? cl::NullRange : cl::NDRange(task.local_size);
+		{
+			std::lock_guard<std::mutex> lock_mutex(this->stats_mutex);
+			this->slot_num_count[task.ring_index] = task.num_count;
+			this->slot_enqueue_times[task.ring_index] = std::chrono::steady_clock::now();
+		}
+		this->cl_dev->dev_queue.enqueueNDRangeKernel(*task.kernel, cl::NullRange, cl::NDRange(task.global_size), local_range, &upload_events, &this->kernel_events[task.ring_index]);
+		{
+			std::lock_guard<std::mutex> lock_mutex(this->stats_mutex); //counted before registration, callback may run immediately
+			this->pending_callbacks++;
+		}
+		if (this->kernel_events[task.ring_index].setCallback(CL_COMPLETE, &DeviceFeeder::on_kernel_complete, &this->callback_data[task.ring_index]) != CL_SUCCESS) {
+			std::lock_guard<std::mutex> lock_mutex(this->stats_mutex); //callback will never be called
+			this->pending_callbacks--;
+		}
+		for (size_t i = 0; i < task.results.size(); i++) { //in-order queue => results are read after the kernel and reset before next kernel starts
+			const cl_task_result_struct& result = task.results[i];
+			this->cl_dev->dev_queue.enqueueReadBuffer(*result.buf, CL_FALSE, 0, result.size, result.host_result);
+			this->cl_dev->dev_queue.enqueueWriteBuffer(*result.buf, CL_FALSE, 0, result.size, result.init_value);
+		}
+
+		this->cl_dev->transfer_queue.flush(); //start upload + kernel without waiting
+		this->cl_dev->dev_queue.flush();
+
+		{
+			std::lock_guard<std::mutex> lock_mutex(this->feeder_mutex);
+			this->slot_states[task.ring_index].store(SLOT_ENQUEUED, std::memory_order_release);
+			this->task_head.store(head + 1, std::memory_order_release);
+		}
+		this->feeder_cond.notify_all(); //producer may wait for drain / for enqueue of the buffer
+		this->notify_scheduler(); //kernel may have completed before buffer state was set
+	}
+}
+
+/*
+Wakes up scheduler which waits until some device can accept task.
+*/
+void DeviceFeeder::notify_scheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock_mutex(*this->sched_mutex); //scheduler cannot miss wake up between check + sleep
+	}
+	this->sched_cond->notify_all();
+}
+
+/*
+Called by OpenCL runtime when kernel completes. Device is considered busy from enqueue of the task (or completion of previous kernel, if later) till completion, throughput is smoothed over tasks.
+cl_event = completed kernel (not used, slot is passed in user_data)
+cl_int event_status = CL_COMPLETE or negative error code
+void* user_data = feeder + input buffer of the task
+*/
+void CL_CALLBACK DeviceFeeder::on_kernel_complete(cl_event /*event*/, cl_int event_status, void* user_data)
+{
+	std::pair<DeviceFeeder*, size_t>* callback_data = static_cast<std::pair<DeviceFeeder*, size_t>*>(user_data);
+	DeviceFeeder* feeder = callback_data->first;
+	size_t slot = callback_data->second;
+
+	{
+		std::lock_guard<std::mutex> lock_mutex(feeder->stats_mutex);
+		std::chrono::steady_clock::time_point complete_time = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point busy_start = std::max(feeder->slot_enqueue_times[slot], feeder->last_complete_time);
+		double busy_secs = std::chrono::duration<double>(complete_time - busy_start).count();
+		feeder->last_complete_time = complete_time;
+
+		if (event_status == CL_COMPLETE && busy_secs > 0) {
+			double task_throughput = feeder->slot_num_count[slot] / busy_secs;
+			double prev_throughput = feeder->throughput.load();
+			feeder->throughput.store(prev_throughput == 0 ? task_throughput : prev_throughput + SCHED_THROUGHPUT_SMOOTHING * (task_throughput - prev_throughput));
+		}
+		feeder->notify_scheduler();
+
+		feeder->pending_callbacks--;
+		feeder->callbacks_cond.notify_all(); //still under lock, feeder is not touched after the lock is released
+	}
+}
+
+/*
+Returns smoothed count of numbers processed by device per second (upload + kernel).
+return = throughput, 0 if no kernel completed yet
+*/
+double DeviceFeeder::get_throughput()
+{
+	return this->throughput.load();
+}
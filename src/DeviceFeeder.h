@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+#include <chrono>
+#include "Structures.h"
+
+//long-lived thread which feeds one OpenCL device - uploads chunks from ring of input buffers (mapped, no host staging copy) and enqueues kernels, tasks are passed through lock-free queue
+class DeviceFeeder
+{
+	private:
+		cl_dev_stuff_struct* cl_dev; //device fed by thread
+		size_t ring_depth; //count of input buffers of device (= capacity of task queue)
+		std::mutex* sched_mutex; //mutex of scheduler waiting for free device
+		std::condition_variable* sched_cond; //notified when kernel completes (input buffer of device becomes free)
+
+		std::vector<double*> host_nums; //host memory of each input buffer - mapped input buffer (zero copy) / mapped pinned staging buffer
+		std::vector<cl::Event> kernel_events; //kernel which last read respective input buffer
+		std::unique_ptr<std::atomic<int>[]> slot_states; //state of each input buffer - SLOT_FREE / SLOT_QUEUED / SLOT_ENQUEUED
+		size_t next_slot; //input buffer which is used by next task (producer only)
+
+		std::vector<cl_feed_task_struct> tasks; //task queue (single producer, single consumer), ring indexed by task counters
+		std::atomic<size_t> task_head; //count of tasks taken by feeder thread
+		std::atomic<size_t> task_tail; //count of tasks submitted by producer
+		std::atomic<bool> feeder_stop; //feeder thread should end
+		std::mutex feeder_mutex; //used only for sleeping / waking feeder thread + producer waiting for drain
+		std::condition_variable feeder_cond; //signals new task / processed task
+		std::thread feeder_thread; //thread which enqueues uploads + kernels
+
+		std::vector<std::pair<DeviceFeeder*, size_t>> callback_data; //feeder + input buffer passed to kernel completion callback
+		std::vector<size_t> slot_num_count; //count of numbers processed by kernel of respective input buffer
+		std::vector<std::chrono::steady_clock::time_point> slot_enqueue_times; //time at which upload + kernel of respective input buffer were enqueued
+		std::chrono::steady_clock::time_point last_complete_time; //time at which last kernel completed
+		std::mutex stats_mutex; //guards throughput statistics + count of pending callbacks (completion callbacks are called by OpenCL runtime thread)
+		size_t pending_callbacks; //count of completion callbacks registered but not finished yet
+		std::condition_variable callbacks_cond; //notified when completion callback finishes, destructor waits for all of them
+		std::atomic<double> throughput; //smoothed count of numbers processed per second (0 = not measured yet)
+
+		double* map_slot(size_t slot, const std::vector<cl::Event>* wait_events); //maps input buffer / pinned staging buffer of slot for writing by host
+		void feed_loop(); //action performed by feeder thread
+		void notify_scheduler(); //wakes up scheduler waiting for free device
+		static void CL_CALLBACK on_kernel_complete(cl_event event, cl_int event_status, void* user_data); //updates throughput when kernel completes
+
+	public:
+		DeviceFeeder(cl_dev_stuff_struct* cl_dev, std::mutex* sched_mutex, std::condition_variable* sched_cond); //constructor expects device with allocated ring of input buffers + scheduler notified on kernel completion, starts feeder thread
+		~DeviceFeeder(); //stops feeder thread
+		bool has_free_slot(); //true if next input buffer can be used (previous kernel using it is finished)
+		double* acquire_slot(size_t* slot_index); //reserves next input buffer, returns host memory to be filled with numbers
+		void submit(const cl_feed_task_struct& task); //passes task to feeder thread
+		void finish(); //waits until all submitted tasks are enqueued + completed by device
+		double get_throughput(); //smoothed count of numbers processed per second, 0 if not measured yet
+};
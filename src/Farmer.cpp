@@ -10,7 +10,11 @@
 #include <algorithm>
 #include <numeric>
 #include <limits>
-#include <future>
+#include <chrono>
+#include <cmath>
+#include "StatsKernel.h"
+#include "ValidityFilter.h"
+#include "RunReport.h"
 
 /*
 Purpose of this class is to detect least occupied device (OpenCL / SMP) and assign work.
@@ -21,170 +25,352 @@ Farmer::Farmer(compute_type sel_comp_type, std::vector<cl_dev_stuff_struct> comp
 {
 	this->sel_comp_type = sel_comp_type;
 	this->cl_devices = compute_cl_devices;
+	this->smp_throughput = 0;
+	this->calc_moments = false;
+	this->normalize_val = 1;
+	this->keep_chunk_stats = false;
+	this->cl_first_pass_init.min_key = ULLONG_MAX; //keys of numbers are compared as ulong
+	this->cl_first_pass_init.max_key = 0;
+	this->cl_first_pass_init.flags = 0;
+	this->cl_first_pass_init.count = 0;
+
+	for (size_t i = 0; i < this->cl_devices.size(); i++) { //one long-lived feeder thread per device
+		this->cl_devices[i].dev_index = static_cast<int>(i);
+		this->cl_dev_names.push_back(this->cl_devices[i].dev.getInfo<CL_DEVICE_NAME>().c_str()); //c_str() - some drivers include terminating null in name
+		this->cl_dev_keys.push_back(this->cl_dev_names[i] + " #" + std::to_string(i));
+		this->cl_feeders.push_back(new DeviceFeeder(&this->cl_devices[i], &this->sched_mutex, &this->sched_cond));
+	}
+}
+
+/*
+Destructor stops feeder threads of OpenCL devices.
+*/
+Farmer::~Farmer()
+{
+	for (size_t i = 0; i < this->cl_feeders.size(); i++) {
+		delete this->cl_feeders[i];
+	}
 }
 
 /*
-Returns vector with CL devices which are currently not working. Ie. latest defined task is finished.
+Returns vector with CL devices which can accept another task. Ie. kernel which last used next input buffer of the device ring is finished (or the buffer was not used yet).
 */
 std::vector<cl_dev_stuff_struct*> Farmer::get_free_cl_devices() {
 	std::vector<cl_dev_stuff_struct*> free_cl_devs;
 
 	for (int i = 0; i < this->cl_devices.size(); i++) { //go through available devices and find free one
-		cl_dev_stuff_struct* one_cl_dev = &this->cl_devices[i];
-		if (!one_cl_dev->current_task.valid() || (one_cl_dev->current_task.wait_for(std::chrono::nanoseconds(0)) == std::future_status::ready)) {
-			free_cl_devs.push_back(one_cl_dev);
+		if (this->cl_feeders[i]->has_free_slot()) {
+			free_cl_devs.push_back(&this->cl_devices[i]);
 		}
 	}
 	return free_cl_devs;
 }
 
 /*
-Prepares devices for first round of algorithm (finding min + max, whether decimal point num is present). Ie. clears buffers etc.
-double init_min_max_val = value to which minimum + maximum is inited
+Returns OpenCL devices which can accept another task. If only OpenCL devices are allowed to compute and all of them are busy, waits (without spinning) until kernel of some device completes.
+return = free OpenCL devices (empty if OpenCL not used / all devices busy and SMP allowed)
+*/
+std::vector<cl_dev_stuff_struct*> Farmer::wait_free_cl_devices() {
+	if (this->cl_devices.size() == 0 || this->sel_comp_type != OPENCL) { //SMP can take work, no need to wait
+		return this->get_free_cl_devices();
+	}
+
+	std::vector<cl_dev_stuff_struct*> free_cl_devs;
+	std::unique_lock<std::mutex> uniq_mutex(this->sched_mutex);
+	this->sched_cond.wait(uniq_mutex, [this, &free_cl_devs] { //feeders notify on each kernel completion
+		free_cl_devs = this->get_free_cl_devices();
+		return free_cl_devs.size() != 0;
+	});
+	return free_cl_devs;
+}
+
+/*
+Splits numbers between free OpenCL devices and SMP according to their measured throughput (numbers per second), so that all of them finish at about the same time.
+Split positions depend on timing, so moments are not bit-reproducible between runs whenever chunk is split between more workers (ALL mode, more OpenCL devices) - parts are merged in fixed order, but the parts themselves differ.
+Worker whose throughput was not measured yet gets average throughput of measured ones (equal parts if nothing measured).
+num_span_struct input_nums = numbers to be split
+std::vector<cl_dev_stuff_struct*>& free_cl_devs = free OpenCL devices
+std::vector<num_span_struct>* cl_parts = part for each free OpenCL device (same order)
+num_span_struct* smp_part = part for SMP (size 0 if SMP is not allowed / OpenCL devices used only)
 */
-void Farmer::prep_devs_min_max_dec_point_neg_num(double init_min_max_val){
-	double init_val_min = DBL_MAX;
-	double init_val_max = 0;
-	bool init_bool = false;
+void Farmer::split_by_throughput(num_span_struct input_nums, std::vector<cl_dev_stuff_struct*>& free_cl_devs, std::vector<num_span_struct>* cl_parts, num_span_struct* smp_part) {
+	bool use_smp = this->cl_devices.size() == 0 || this->sel_comp_type != OPENCL; //OpenCL allowed but not found => SMP
 
+	std::vector<double> worker_throughputs; //OpenCL devices, then SMP
+	for (size_t i = 0; i < free_cl_devs.size(); i++) {
+		worker_throughputs.push_back(this->cl_feeders[free_cl_devs[i]->dev_index]->get_throughput());
+	}
+	if (use_smp) {
+		worker_throughputs.push_back(this->smp_throughput);
+	}
+
+	double measured_sum = 0;
+	int measured_count = 0;
+	for (size_t i = 0; i < worker_throughputs.size(); i++) {
+		if (worker_throughputs[i] > 0) {
+			measured_sum += worker_throughputs[i];
+			measured_count++;
+		}
+	}
+	double default_throughput = measured_count == 0 ? 1 : measured_sum / measured_count;
+	double throughput_sum = 0;
+	for (size_t i = 0; i < worker_throughputs.size(); i++) {
+		if (worker_throughputs[i] <= 0) {
+			worker_throughputs[i] = default_throughput;
+		}
+		throughput_sum += worker_throughputs[i];
+	}
+
+	//parts are given by cumulative share of throughput, rounding does not lose any number
+	double throughput_prefix = 0;
+	size_t part_start = 0;
+	cl_parts->clear();
+	for (size_t i = 0; i < worker_throughputs.size(); i++) {
+		throughput_prefix += worker_throughputs[i];
+		size_t part_end = (i == worker_throughputs.size() - 1) ? input_nums.size : std::min(input_nums.size, static_cast<size_t>(input_nums.size * (throughput_prefix / throughput_sum)));
+
+		num_span_struct part = input_nums;
+		part.nums = input_nums.nums + part_start;
+		part.size = part_end - part_start;
+		if (i < free_cl_devs.size()) {
+			cl_parts->push_back(part);
+		}
+		else {
+			*smp_part = part;
+		}
+		part_start = part_end;
+	}
+	if (!use_smp) {
+		*smp_part = input_nums;
+		smp_part->size = 0;
+	}
+}
+
+/*
+Updates smoothed throughput of SMP (TBB pool) after it processed part of chunk.
+size_t num_count = count of processed numbers
+double secs = time spent by processing
+*/
+void Farmer::update_smp_throughput(size_t num_count, double secs) {
+	if (secs <= 0) {
+		return;
+	}
+	double part_throughput = num_count / secs;
+	this->smp_throughput = this->smp_throughput == 0 ? part_throughput : this->smp_throughput + SCHED_THROUGHPUT_SMOOTHING * (part_throughput - this->smp_throughput);
+}
+
+/*
+Prepares devices for first round of algorithm (finding min + max, whether decimal point num is present). Ie. clears buffers etc.
+If statistics of each chunk are kept, results of OpenCL devices are read after every kernel and SMP part of chunk is reduced separately - no number is read twice.
+bool keep_chunk_stats = true if statistics of each chunk should be kept (see retr_chunk_first_pass_stats)
+*/
+void Farmer::prep_devs_min_max_dec_point_neg_num(bool keep_chunk_stats){
 	//init opencl
 	for (int i = 0; i < this->cl_devices.size(); i++) { //go through all devices
 		cl_dev_stuff_struct* one_cl_dev = &this->cl_devices[i];
 		cl::CommandQueue* queue = &one_cl_dev->dev_queue;
 
-		queue->enqueueWriteBuffer(one_cl_dev->res_min_pos_buf, CL_TRUE, 0, sizeof(double), &init_val_min); //min buf
-		queue->enqueueWriteBuffer(one_cl_dev->res_max_pos_buf, CL_TRUE, 0, sizeof(double), &init_val_max); //max buf
-		queue->enqueueWriteBuffer(one_cl_dev->res_min_neg_buf, CL_TRUE, 0, sizeof(double), &init_val_min); //min buf
-		queue->enqueueWriteBuffer(one_cl_dev->res_max_neg_buf, CL_TRUE, 0, sizeof(double), &init_val_max); //max buf
-		queue->enqueueWriteBuffer(one_cl_dev->res_dec_point_num_buf, CL_TRUE, 0, sizeof(int), &init_val_max); //decimal point num buf
+		queue->enqueueWriteBuffer(one_cl_dev->res_min_buf, CL_TRUE, 0, sizeof(cl_ulong), &this->cl_first_pass_init.min_key); //min buf
+		queue->enqueueWriteBuffer(one_cl_dev->res_max_buf, CL_TRUE, 0, sizeof(cl_ulong), &this->cl_first_pass_init.max_key); //max buf
+		queue->enqueueWriteBuffer(one_cl_dev->res_flags_buf, CL_TRUE, 0, sizeof(cl_int), &this->cl_first_pass_init.flags); //decimal point / negative num buf
+		queue->enqueueWriteBuffer(one_cl_dev->res_count_buf, CL_TRUE, 0, sizeof(cl_ulong), &this->cl_first_pass_init.count); //count buf
 		queue->finish();
 	}
+	this->keep_chunk_stats = keep_chunk_stats;
+	this->chunk_first_pass_stats.clear();
+	this->cl_chunk_first_pass_res.clear();
 
-	//init smp
-	this->min_value_global = tbb::enumerable_thread_specific<double>(init_val_min);
-	this->max_value_global = tbb::enumerable_thread_specific<double>(init_val_max);
-	this->dec_point_num_global = tbb::enumerable_thread_specific<bool>(init_bool);
-	this->negative_num_global = tbb::enumerable_thread_specific<bool>(init_bool);
+	//init smp - defaults of block_stats_struct (no valid number yet, max starts at -DBL_MAX so that negative data are handled)
+	this->first_pass_stats_global = tbb::enumerable_thread_specific<block_stats_struct>(block_stats_struct());
 }
 
 /*
 Prepares devs for second round of algorithm - adding nums to intervals, finding average. Clears buffers for given values.
+Buffer with interval counters is sized by count of intervals of the job (reallocated only if it is larger than current one).
+If intervals fit into local memory of device, kernel with intervals privatized per work-group is selected, else kernel with global memory intervals.
+int interval_count = count of intervals
+bool calc_moments = true if moments (average + variance) of dataset should be calculated together with intervals
+double normalize_val = each number is divided by this value before moments are calculated
 */
-void Farmer::prep_devs_intervals(int interval_count) {
+void Farmer::prep_devs_intervals(int interval_count, bool calc_moments, double normalize_val) {
 	double init_val = 0;
-	int init_val_int = 0;
+	cl_ulong init_val_ulong = 0;
 
 	//init opencl
 	for (int i = 0; i < this->cl_devices.size(); i++) { //go through all devices
 		cl_dev_stuff_struct* one_cl_dev = &this->cl_devices[i];
 		cl::CommandQueue* queue = &one_cl_dev->dev_queue;
 
-		std::vector<int> output_intervals(MAX_OUTPUT_INTERVAL_COUNT, 0); //output buffer
+		if (one_cl_dev->output_intervals_capacity < interval_count) { //buffer of previous job is too small
+			cl_int buffer_error = 0;
+			one_cl_dev->output_intervals_buf = cl::Buffer(one_cl_dev->dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, interval_count * sizeof(cl_ulong), NULL, &buffer_error); //output, 64-bit interval counter - cleared on device, host read only
+			if (buffer_error != CL_SUCCESS) {
+				std::cout << "ERROR: creation of OpenCL buffer for interval counters (output) failed, error code: " << buffer_error << std::endl;
+			}
+			one_cl_dev->output_intervals_capacity = interval_count;
+			one_cl_dev->ker_add_nums_intervals.setArg(2, one_cl_dev->output_intervals_buf);
+			one_cl_dev->ker_add_nums_intervals_local.setArg(2, one_cl_dev->output_intervals_buf);
+		}
+		queue->enqueueFillBuffer(one_cl_dev->output_intervals_buf, init_val_ulong, 0, interval_count * sizeof(cl_ulong)); //only intervals of the job are cleared
+		one_cl_dev->ker_add_nums_intervals.setArg(3, interval_count);
+		one_cl_dev->ker_add_nums_intervals_local.setArg(3, interval_count);
+
+		//local memory used by kernel itself (moments of work-items) is measured with minimal size of local intervals
+		one_cl_dev->ker_add_nums_intervals_local.setArg(10, cl::Local(sizeof(cl_uint)));
+		cl_ulong local_mem_size = one_cl_dev->dev.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+		cl_ulong kernel_local_mem_size = one_cl_dev->ker_add_nums_intervals_local.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE>(one_cl_dev->dev);
+		one_cl_dev->use_local_intervals = interval_count * sizeof(cl_uint) + kernel_local_mem_size <= local_mem_size; //local counts stay 32-bit (one work-group never counts more than one chunk)
+		if (one_cl_dev->use_local_intervals) {
+			one_cl_dev->ker_add_nums_intervals_local.setArg(10, cl::Local(interval_count * sizeof(cl_uint)));
+		}
 
-		queue->enqueueWriteBuffer(one_cl_dev->output_intervals_buf, CL_TRUE, 0, sizeof(int) * output_intervals.size(), output_intervals.data()); //buffer for output interval
+		this->cl_moment_partials_init.assign(CL_MOMENT_PARTIAL_COUNT * 3, 0); //count, mean, M2 of each work-group
+		queue->enqueueWriteBuffer(one_cl_dev->moment_partials_buf, CL_TRUE, 0, sizeof(double) * this->cl_moment_partials_init.size(), this->cl_moment_partials_init.data());
+		one_cl_dev->ker_add_nums_intervals.setArg(7, calc_moments ? 1 : 0);
+		one_cl_dev->ker_add_nums_intervals.setArg(8, normalize_val);
+		one_cl_dev->ker_add_nums_intervals_local.setArg(7, calc_moments ? 1 : 0);
+		one_cl_dev->ker_add_nums_intervals_local.setArg(8, normalize_val);
 		queue->finish();
 	}
 
 	//init smp
-	this->output_intervals_combined = std::vector<int>(interval_count, 0);
+	this->output_intervals_combined = std::vector<long long>(interval_count, 0);
+	this->smp_intervals_local.clear(); //histograms of threads are created by first block processed by each thread
+	this->smp_intervals_shared.reset();
+	if (interval_count >= SMP_SHARED_INTERVALS_MIN) { //histogram per thread would not fit into cache => one shared histogram with atomic counters
+		this->smp_intervals_shared.reset(new std::atomic<long long>[interval_count]);
+		for (int i = 0; i < interval_count; i++) {
+			this->smp_intervals_shared[i].store(0, std::memory_order_relaxed);
+		}
+	}
+	this->calc_moments = calc_moments;
+	this->normalize_val = normalize_val;
+	this->smp_chunk_moments.clear();
+	this->cl_chunk_moments.clear();
 }
 
 /*
 Finds out if given number represents minimum / maximum in dataset and updates respective variables. Also checks whether given value is decimal or negative. If so, updates corresponding bool variables.
-std::vector<double> input_nums = numbers to be processed
+Numbers do not have to be filtered - invalid ones (std::fpclassify does not give FP_NORMAL / FP_ZERO) are skipped and valid ones are counted by workers.
+Numbers are split between free OpenCL devices and SMP according to their throughput.
+num_span_struct input_nums = numbers to be processed
 */
-void Farmer::assign_min_max_dec_point_neg_num(std::vector<double> input_nums)
+void Farmer::assign_min_max_dec_point_neg_num(num_span_struct input_nums)
 {
-	if (this->cl_devices.size() != 0) { //cl devices allowed + present, check free ones
-		std::vector<cl_dev_stuff_struct*> free_cl_devs = this->get_free_cl_devices();
-		if (free_cl_devs.size() == 0) { //all openCL devices working
-			if (this->sel_comp_type != OPENCL) { //assign to SMP, allowed
-				smp_min_max_dec_point_neg_num(input_nums);
-			}
-			else { //only OpenCL devices allowed, wait for one..
-				while (true) {
-					free_cl_devs = this->get_free_cl_devices();
-					if (free_cl_devs.size() != 0) {
-						assign_min_max_dec_point_neg_num(input_nums);
-						break;
-					}
-				}
-			}
-		}
-		else { //split work into free cl devices / SMP
-			int original_data_size = static_cast<int>(input_nums.size());
-			int chunk_size = original_data_size / static_cast<int>(free_cl_devs.size());
-
-			int i = 0;
-			std::vector<double> chunk_data;
-			for (; i < free_cl_devs.size() - 1; i++) { //assign OpenCL
-				chunk_data = std::vector<double>{ input_nums.begin() + (chunk_size * i), input_nums.begin() + (chunk_size * (i + 1)) };
-				cl_min_max_dec_point_neg_num(chunk_data, free_cl_devs[i]);
-			}
+	std::vector<cl_dev_stuff_struct*> free_cl_devs = this->wait_free_cl_devices();
+	std::vector<num_span_struct> cl_parts;
+	num_span_struct smp_part;
+	this->split_by_throughput(input_nums, free_cl_devs, &cl_parts, &smp_part);
+	if (this->keep_chunk_stats && this->chunk_first_pass_stats.size() <= input_nums.chunk_index) {
+		this->chunk_first_pass_stats.resize(input_nums.chunk_index + 1);
+	}
 
-			//assign last chunk
-			chunk_data = std::vector<double>{ input_nums.begin() + (chunk_size * i), (input_nums.end()) };
-			cl_min_max_dec_point_neg_num(chunk_data, free_cl_devs[i]);
+	for (size_t i = 0; i < free_cl_devs.size(); i++) { //assign OpenCL, devices work while SMP processes its part
+		if (cl_parts[i].size != 0) {
+			cl_min_max_dec_point_neg_num(cl_parts[i], free_cl_devs[i]);
+			RunReport::get_instance()->add_device_chunk(this->cl_dev_keys[free_cl_devs[i]->dev_index], this->cl_dev_names[free_cl_devs[i]->dev_index], cl_parts[i].size);
 		}
 	}
-	else { //Cl allowed but not found, use SMP
-		smp_min_max_dec_point_neg_num(input_nums);
+	if (smp_part.size != 0) {
+		std::chrono::steady_clock::time_point smp_start = std::chrono::steady_clock::now();
+		smp_min_max_dec_point_neg_num(smp_part);
+		this->update_smp_throughput(smp_part.size, std::chrono::duration<double>(std::chrono::steady_clock::now() - smp_start).count());
+		RunReport::get_instance()->add_device_chunk("SMP", "SMP", smp_part.size);
 	}
 }
 
 /*
 Assign the respective job to OpenCL device.
-std::vector<double> input_nums = numbers to be processed
+Raw numbers are copied into mapped input buffer of device ring (view of the chunk is not valid after the function returns), invalid ones are skipped and valid ones counted by kernel. Upload + kernel are enqueued by feeder thread of the device.
+num_span_struct input_nums_span = numbers to be processed
 cl_dev_stuff_struct* least_occ_cl_dev = least occupied device
 */
-void Farmer::cl_min_max_dec_point_neg_num(std::vector<double> input_nums, cl_dev_stuff_struct* least_occ_cl_dev) {
-	cl::Kernel* kernel = &least_occ_cl_dev->ker_min_max_dec_point_neg_num;
-
-	int input_nums_size = static_cast<int>(input_nums.size());
-	kernel->setArg(6, input_nums_size);
-
-	least_occ_cl_dev->current_task = std::async(std::launch::async, [least_occ_cl_dev, input_nums, input_nums_size]() {
-		cl::Kernel* kernel = &least_occ_cl_dev->ker_min_max_dec_point_neg_num;
-		cl::CommandQueue* queue = &least_occ_cl_dev->dev_queue;
-
-		queue->enqueueWriteBuffer(least_occ_cl_dev->input_nums_buf, CL_TRUE, 0, input_nums_size * sizeof(double), input_nums.data());
-		queue->enqueueNDRangeKernel(*kernel, cl::NullRange, cl::NDRange(input_nums.size()), cl::NullRange, NULL);
-	});
+void Farmer::cl_min_max_dec_point_neg_num(num_span_struct input_nums_span, cl_dev_stuff_struct* least_occ_cl_dev) {
+	if (input_nums_span.size == 0) { //kernel cannot be enqueued with empty range
+		return;
+	}
+	DeviceFeeder* feeder = this->cl_feeders[least_occ_cl_dev->dev_index];
+
+	size_t ring_index;
+	double* input_nums = feeder->acquire_slot(&ring_index);
+	size_t input_nums_size = input_nums_span.size;
+	std::copy(input_nums_span.nums, input_nums_span.nums + input_nums_size, input_nums); //written directly into mapped memory of device
+
+	//each work-item reduces CL_REDUCTION_NUMS_PER_ITEM numbers, global size is multiple of work-group size
+	size_t group_size = least_occ_cl_dev->reduction_group_size;
+	size_t group_count = (input_nums_size + group_size * CL_REDUCTION_NUMS_PER_ITEM - 1) / (group_size * CL_REDUCTION_NUMS_PER_ITEM);
+
+	cl_feed_task_struct task;
+	task.kernel = &least_occ_cl_dev->ker_min_max_dec_point_neg_num;
+	task.ring_index = ring_index;
+	task.num_count = input_nums_size;
+	task.input_buf_arg = 4;
+	task.input_size_arg = 5;
+	task.global_size = group_count * group_size;
+	task.local_size = group_size;
+	if (this->keep_chunk_stats) { //results of the part are read right after kernel, merged into its chunk in retr_min_max_dec_point_neg_num_res
+		this->cl_chunk_first_pass_res.push_back(this->cl_first_pass_init);
+		cl_first_pass_res_struct* part_res = &this->cl_chunk_first_pass_res.back();
+		part_res->chunk_index = input_nums_span.chunk_index;
+		task.results.resize(4);
+		task.results[0] = { &least_occ_cl_dev->res_min_buf, sizeof(cl_ulong), &part_res->min_key, &this->cl_first_pass_init.min_key };
+		task.results[1] = { &least_occ_cl_dev->res_max_buf, sizeof(cl_ulong), &part_res->max_key, &this->cl_first_pass_init.max_key };
+		task.results[2] = { &least_occ_cl_dev->res_flags_buf, sizeof(cl_int), &part_res->flags, &this->cl_first_pass_init.flags };
+		task.results[3] = { &least_occ_cl_dev->res_count_buf, sizeof(cl_ulong), &part_res->count, &this->cl_first_pass_init.count };
+	}
+	feeder->submit(task);
 }
 
 /*
-Assign the respective job to SMP device.
-std::vector<double> input_nums = numbers to be processed
+Assign the respective job to SMP device. Each block is processed by fused vector kernel - validity, count, min, max, negative and decimal point flags are determined during one read of the numbers.
+If statistics of each chunk are kept, blocks are reduced into statistics of the part, which is merged into its chunk + into statistics of calling thread.
+num_span_struct input_nums_span = numbers to be processed
 */
-void Farmer::smp_min_max_dec_point_neg_num(std::vector<double> input_nums) {
+void Farmer::smp_min_max_dec_point_neg_num(num_span_struct input_nums_span) {
+	const double* input_nums = input_nums_span.nums;
+
+	if (this->keep_chunk_stats) {
+		block_stats_struct part_stats = StatsKernel::calc_chunk_first_pass(input_nums, input_nums_span.size);
+		StatsKernel::merge_first_pass(&this->chunk_first_pass_stats[input_nums_span.chunk_index], part_stats);
+		StatsKernel::merge_first_pass(&first_pass_stats_global.local(), part_stats);
+		return;
+	}
 
 	auto tbb_first_pass_worker = [&](tbb::blocked_range<size_t> br) {
-		//local values for one block - START
-		double& min_value_local = min_value_global.local();
-		double& max_value_local = max_value_global.local();
-		bool& dec_point_num_local = dec_point_num_global.local();
-		bool& negative_num_local = negative_num_global.local();
-		//local values for one block - END
-
-		for (size_t i = br.begin(); i < br.end(); i++) { //run on more threads
-			if (input_nums[i] < min_value_local) { //num represents current minimum in dataset
-				min_value_local = input_nums[i];
-			}
-
-			if (input_nums[i] > max_value_local) { //num represents current maximum in dataset
-				max_value_local = input_nums[i];
-			}
+		block_stats_struct& stats_local = first_pass_stats_global.local(); //local values for one thread
+		StatsKernel::merge_first_pass(&stats_local, StatsKernel::calc_first_pass(input_nums + br.begin(), br.size()));
+	};
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, input_nums_span.size), tbb_first_pass_worker);
+}
 
-			if (fmod(input_nums[i], 1) != 0) { //num represents decimal point number
-				dec_point_num_local = true;
-			}
+/*
+Converts ordered ulong key used by OpenCL kernel (min / max done by ulong atomics) back to double. Negative numbers have all bits flipped, positive ones have sign bit set.
+cl_ulong key = key computed by kernel
+return = original number
+*/
+static double cl_key_to_num(cl_ulong key) {
+	cl_ulong bits = (key & 0x8000000000000000ULL) ? (key & 0x7FFFFFFFFFFFFFFFULL) : ~key;
+	double num;
+	memcpy(&num, &bits, sizeof(num));
+	return num;
+}
 
-			if (input_nums[i] < 0) { //num is negative -> switch bool flag
-				negative_num_local = true;
-			}
-		}
-	};
-	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, input_nums.size()), tbb_first_pass_worker);
+/*
+Converts results of first round kernel (ordered keys, flags) to statistics used by SMP.
+const cl_first_pass_res_struct& res = results read from device
+return = statistics of numbers processed by kernel (min / max not defined if count is 0)
+*/
+static block_stats_struct cl_first_pass_to_stats(const cl_first_pass_res_struct& res) {
+	block_stats_struct stats;
+	if (res.count == 0) { //device did not process any number
+		return stats;
+	}
+	stats.min_value = cl_key_to_num(res.min_key);
+	stats.max_value = cl_key_to_num(res.max_key);
+	stats.count = static_cast<long long>(res.count);
+	stats.dec_point_num = (res.flags & CL_FLAG_DEC_POINT_NUM) != 0;
+	stats.negative_num = (res.flags & CL_FLAG_NEGATIVE_NUM) != 0;
+	return stats;
 }
 
 /*
@@ -193,112 +379,73 @@ double* res_min_value = minimum value found accross all devices
 double* res_max_value = maximum value found accross all devices
 bool* res_dec_point_num = if decimal value found by atleast one device = true, else false
 bool* res_negative_num = if negative value found by atleast one device = true, else false
+long long* res_count = count of valid numbers processed by all devices
 */
-void Farmer::retr_min_max_dec_point_neg_num_res(double* res_min_value, double* res_max_value, bool* res_dec_point_num, bool* res_negative_num) {
-	bool cl_vals_valid = false; //at least one opencl device used during computing
-	bool smp_vals_valid = false; //at least one thread used during computing
-
-	std::vector<double> cl_min_value_pos_all; //cl - minimum value of each device + 
-	std::vector<double> cl_max_value_pos_all; //cl - max dataset value of each device +
-	std::vector<double> cl_min_value_neg_all; //cl - minimum value of each device -
-	std::vector<double> cl_max_value_neg_all; //cl - max dataset value of each device -
-	std::vector<int> cl_dec_point_num_all; //cl - decimal point number present bool flag of each dev.
+void Farmer::retr_min_max_dec_point_neg_num_res(double* res_min_value, double* res_max_value, bool* res_dec_point_num, bool* res_negative_num, long long* res_count) {
+	bool smp_vals_valid = false; //at least one thread processed valid number
+	*res_min_value = 0;
+	*res_max_value = 0;
+	*res_dec_point_num = false;
+	*res_negative_num = false;
+	block_stats_struct cl_stats_total; //min, max, valid count, flags of all cl devices
 
 	for (int i = 0; i < this->cl_devices.size(); i++) { //go through all cl devices
 		cl_dev_stuff_struct* one_cl_dev = &this->cl_devices[i];
 		cl::CommandQueue* queue = &one_cl_dev->dev_queue;
-		one_cl_dev->current_task.wait(); //wait for all tasks to complete
-
-		double res_min_pos_cl; //min of device + sign
-		double res_max_pos_cl; //max of device + sign
-		double res_min_neg_cl; //min of device - sign
-		double res_max_neg_cl; //max of device - sign
-		int res_dec_point_num_cl; //decimal point value found by OpenCL device
-
-		queue->enqueueReadBuffer(one_cl_dev->res_min_pos_buf, CL_TRUE, 0, sizeof(double), &res_min_pos_cl);
-		queue->enqueueReadBuffer(one_cl_dev->res_max_pos_buf, CL_TRUE, 0, sizeof(double), &res_max_pos_cl);
-		queue->enqueueReadBuffer(one_cl_dev->res_min_neg_buf, CL_TRUE, 0, sizeof(double), &res_min_neg_cl);
-		queue->enqueueReadBuffer(one_cl_dev->res_max_neg_buf, CL_TRUE, 0, sizeof(double), &res_max_neg_cl);
-		queue->enqueueReadBuffer(one_cl_dev->res_dec_point_num_buf, CL_TRUE, 0, sizeof(int), &res_dec_point_num_cl);
-
-		cl_min_value_pos_all.push_back(res_min_pos_cl);
-		cl_max_value_pos_all.push_back(res_max_pos_cl);
-		cl_min_value_neg_all.push_back(res_min_neg_cl);
-		cl_max_value_neg_all.push_back(res_max_neg_cl);
-		cl_dec_point_num_all.push_back(res_dec_point_num_cl);
-	}
-	
-	double cl_min_value_pos_total = 0; //minimal value retrieved by cl device +
-	double cl_max_value_pos_total = 0; //maximum value retrieved by cl device +
-	double cl_min_value_neg_total = 0; //minimal value retrieved by cl device -
-	double cl_max_value_neg_total = 0; //maximum value retrieved by cl device -
-
-	double cl_min_value_total = 0; //final min value (after sign fix)
-	double cl_max_value_total = 0; //final max value (aft sign fix)
-
-	bool cl_dec_point_num_found = false; //at least one cl dev found decimal point number
-	bool cl_negative_num_found = false; //at least one cl dev found negative number
-	if (cl_min_value_pos_all.size() > 0) { //at least one dev used during openCL computation
-		cl_vals_valid = true;
-
-		cl_min_value_pos_total = std::min_element<>(cl_min_value_pos_all.begin(), cl_min_value_pos_all.end())[0];
-		cl_max_value_pos_total = std::max_element<>(cl_max_value_pos_all.begin(), cl_max_value_pos_all.end())[0];
-		cl_min_value_neg_total = std::min_element<>(cl_min_value_neg_all.begin(), cl_min_value_neg_all.end())[0];
-		cl_max_value_neg_total = std::max_element<>(cl_max_value_neg_all.begin(), cl_max_value_neg_all.end())[0];
-
-		if (std::find(begin(cl_dec_point_num_all), end(cl_dec_point_num_all), 1) == end(cl_dec_point_num_all)) {
-			cl_dec_point_num_found = false;
-		}
-		else {
-			cl_dec_point_num_found = true;
-		}
+		this->cl_feeders[i]->finish(); //wait for all tasks to complete
 
-		//parse OpenCL results (+ - sign omitted)
-		//edit retrieved values (because of sign...)
-		if ((std::abs(DBL_MAX - cl_min_value_pos_total) > DBL_EPSILON || std::abs(cl_max_value_pos_total) > DBL_EPSILON) && (std::abs(DBL_MAX - cl_min_value_neg_total) < DBL_EPSILON && std::abs(cl_max_value_neg_total) < DBL_EPSILON)) { //+ boundaries changed, - not => only positive numbers
-			cl_min_value_total = cl_min_value_pos_total;
-			cl_max_value_total = cl_max_value_pos_total;
+		cl_first_pass_res_struct res_cl; //results accumulated by device (initial values only if results were read after each kernel), zeroed - no valid numbers
+		cl_int read_error = queue->enqueueReadBuffer(one_cl_dev->res_min_buf, CL_TRUE, 0, sizeof(cl_ulong), &res_cl.min_key);
+		if (read_error == CL_SUCCESS) {
+			read_error = queue->enqueueReadBuffer(one_cl_dev->res_max_buf, CL_TRUE, 0, sizeof(cl_ulong), &res_cl.max_key);
+		}
+		if (read_error == CL_SUCCESS) {
+			read_error = queue->enqueueReadBuffer(one_cl_dev->res_flags_buf, CL_TRUE, 0, sizeof(cl_int), &res_cl.flags);
 		}
-		else if ((std::abs(DBL_MAX - cl_min_value_neg_total) > DBL_EPSILON || std::abs(cl_max_value_neg_total) > DBL_EPSILON) && (std::abs(DBL_MAX - cl_min_value_pos_total) < DBL_EPSILON && std::abs(cl_max_value_pos_total) < DBL_EPSILON)) { //- boundaries changed, + not => only negative numbers
-			cl_min_value_total = -cl_min_value_neg_total; //add - sign
-			cl_max_value_total = -cl_max_value_neg_total; //add - sign
+		if (read_error == CL_SUCCESS) {
+			read_error = queue->enqueueReadBuffer(one_cl_dev->res_count_buf, CL_TRUE, 0, sizeof(cl_ulong), &res_cl.count);
 		}
-		else { //- to + boundaries
-			cl_min_value_total = -cl_max_value_neg_total;
-			cl_max_value_total = cl_max_value_pos_total;
+		if (read_error != CL_SUCCESS) { //partially read values are not usable, device is skipped
+			std::cout << "ERROR: reading of first round results from OpenCL device \"" << one_cl_dev->dev.getInfo<CL_DEVICE_NAME>() << "\" failed, error code: " << read_error << ". Results of the device are ignored." << std::endl;
+			continue;
 		}
+		StatsKernel::merge_first_pass(&cl_stats_total, cl_first_pass_to_stats(res_cl));
 	}
 
-	if (cl_min_value_total < 0) { //negative num detected by atleast one device
-		cl_negative_num_found = true;
+	for (size_t i = 0; i < this->cl_chunk_first_pass_res.size(); i++) { //results of OpenCL parts of each chunk (keep_chunk_stats), all kernels finished above
+		block_stats_struct part_stats = cl_first_pass_to_stats(this->cl_chunk_first_pass_res[i]);
+		StatsKernel::merge_first_pass(&this->chunk_first_pass_stats[this->cl_chunk_first_pass_res[i].chunk_index], part_stats);
+		StatsKernel::merge_first_pass(&cl_stats_total, part_stats);
 	}
+	this->cl_chunk_first_pass_res.clear();
+
+	bool cl_vals_valid = cl_stats_total.count > 0; //at least one opencl device processed valid number
+	double cl_min_value_total = cl_stats_total.min_value; //minimal value retrieved by cl devices
+	double cl_max_value_total = cl_stats_total.max_value; //maximum value retrieved by cl devices
+	bool cl_dec_point_num_found = cl_stats_total.dec_point_num; //at least one cl dev found decimal point number
+	bool cl_negative_num_found = cl_stats_total.negative_num; //at least one cl dev found negative number
+	long long cl_valid_count = cl_stats_total.count; //count of numbers processed by cl devices
 
 	//retrieve SMP values
 	double smp_min_value_total = 0;
 	double smp_max_value_total = 0;
 	bool smp_dec_point_num_found = false;
 	bool smp_negative_num_found = false;
+	long long smp_valid_count = 0;
 
-	if (min_value_global.size() > 0 && max_value_global.size() && dec_point_num_global.size() > 0 && negative_num_global.size() > 0) {
-		smp_vals_valid = true;
-
-		smp_min_value_total = std::min_element<>(min_value_global.begin(), min_value_global.end())[0];
-		smp_max_value_total = std::max_element<>(max_value_global.begin(), max_value_global.end())[0];
-
-		if (std::find(dec_point_num_global.begin(), dec_point_num_global.end(), true) == dec_point_num_global.end()) {
-			smp_dec_point_num_found = false;
-		}
-		else {
-			smp_dec_point_num_found = true;
-		}
-
-		if (std::find(negative_num_global.begin(), negative_num_global.end(), true) == negative_num_global.end()) {
-			smp_negative_num_found = false;
-		}
-		else {
-			smp_negative_num_found = true;
-		}
+	if (first_pass_stats_global.size() > 0) {
+		block_stats_struct smp_stats_total = first_pass_stats_global.combine([](block_stats_struct stats_1, const block_stats_struct& stats_2) {
+			StatsKernel::merge_first_pass(&stats_1, stats_2);
+			return stats_1;
+		});
+		smp_vals_valid = smp_stats_total.count > 0;
+		smp_min_value_total = smp_stats_total.min_value;
+		smp_max_value_total = smp_stats_total.max_value;
+		smp_dec_point_num_found = smp_stats_total.dec_point_num;
+		smp_negative_num_found = smp_stats_total.negative_num;
+		smp_valid_count = smp_stats_total.count;
 	}
+	*res_count = smp_valid_count + cl_valid_count;
 
 	if (cl_vals_valid == true && smp_vals_valid == false) { //only openCL used, return openCL values
 		*res_min_value = cl_min_value_total;
@@ -312,10 +459,10 @@ void Farmer::retr_min_max_dec_point_neg_num_res(double* res_min_value, double* r
 		*res_dec_point_num = smp_dec_point_num_found;
 		*res_negative_num = smp_negative_num_found;
 	}
-	else { //openCL + SMP used, pick suitable
+	else if (cl_vals_valid == true && smp_vals_valid == true) { //openCL + SMP used, pick suitable (no valid number at all => zeroed results)
 		*res_min_value = std::fmin(cl_min_value_total, smp_min_value_total);
 		*res_max_value = std::fmax(cl_max_value_total, smp_max_value_total);
-		if (cl_dec_point_num_found == true || smp_negative_num_found == true) {
+		if (cl_dec_point_num_found == true || smp_dec_point_num_found == true) {
 			*res_dec_point_num = true;
 		}
 
@@ -327,135 +474,179 @@ void Farmer::retr_min_max_dec_point_neg_num_res(double* res_min_value, double* r
 }
 
 /*
-Assigns task which adds number from dataset to corresponding interval to least occupied device.
-std::vector<double> input_nums = numbers to be processed
+Returns statistics of each chunk gathered during first round (prep_devs_min_max_dec_point_neg_num with keep_chunk_stats). Must be called after retr_min_max_dec_point_neg_num_res, which merges results of OpenCL parts into their chunks.
+return = statistics of each chunk (index = chunk index), chunks which were not processed have count 0
+*/
+std::vector<block_stats_struct> Farmer::retr_chunk_first_pass_stats() {
+	return this->chunk_first_pass_stats;
+}
+
+/*
+Assigns task which adds number from dataset to corresponding interval. Numbers are split between free OpenCL devices and SMP according to their throughput.
+Numbers do not have to be filtered - invalid ones are skipped by workers (OpenCL kernels as well).
+num_span_struct input_nums = numbers to be processed
 double interval_size = size of each interval
 double min_value_data = minimum value found in data
 int interval_count = number of intervals
 */
-void Farmer::assign_add_nums_to_intervals(std::vector<double> input_nums, double interval_size, double min_value_data, int interval_count)
+void Farmer::assign_add_nums_to_intervals(num_span_struct input_nums, double interval_size, double min_value_data, int interval_count)
 {
-	if (this->cl_devices.size() != 0) { //cl devices allowed + present, check free ones
-		std::vector<cl_dev_stuff_struct*> free_cl_devs = this->get_free_cl_devices();
-		if (free_cl_devs.size() == 0) { //all openCL devices working
-			if (this->sel_comp_type != OPENCL) { //assign to SMP, allowed
-				smp_add_nums_to_intervals(input_nums, interval_size, min_value_data, interval_count);
-			}
-			else { //only OpenCL devices allowed, wait for one..
-				while (true) {
-					free_cl_devs = this->get_free_cl_devices();
-					if (free_cl_devs.size() != 0) {
-						assign_add_nums_to_intervals(input_nums, interval_size, min_value_data, interval_count);
-						break;
-					}
-				}
-			}
-		}
-		else { //split work into free cl devices / SMP
-			int original_data_size = static_cast<int>(input_nums.size());
-			int chunk_size = original_data_size / static_cast<int>(free_cl_devs.size());
-
-			int i = 0;
-			std::vector<double> chunk_data;
-			for (; i < free_cl_devs.size() - 1; i++) { //assign OpenCL
-				chunk_data = std::vector<double>{ input_nums.begin() + (chunk_size * i), input_nums.begin() + (chunk_size * (i + 1)) };
-				cl_add_nums_to_intervals(chunk_data, interval_size, min_value_data, free_cl_devs[i]);
-			}
-
-			//assign last chunk
-			chunk_data = std::vector<double>{ input_nums.begin() + (chunk_size * i), (input_nums.end()) };
-			cl_add_nums_to_intervals(chunk_data, interval_size, min_value_data, free_cl_devs[i]);
+	std::vector<cl_dev_stuff_struct*> free_cl_devs = this->wait_free_cl_devices();
+	std::vector<num_span_struct> cl_parts;
+	num_span_struct smp_part;
+	this->split_by_throughput(input_nums, free_cl_devs, &cl_parts, &smp_part);
+
+	for (size_t i = 0; i < free_cl_devs.size(); i++) { //assign OpenCL, devices work while SMP processes its part
+		if (cl_parts[i].size != 0) {
+			cl_add_nums_to_intervals(cl_parts[i], interval_size, min_value_data, free_cl_devs[i]);
+			RunReport::get_instance()->add_device_chunk(this->cl_dev_keys[free_cl_devs[i]->dev_index], this->cl_dev_names[free_cl_devs[i]->dev_index], cl_parts[i].size);
 		}
 	}
-	else { //Cl allowed but not found, use SMP
-		smp_add_nums_to_intervals(input_nums, interval_size, min_value_data, interval_count);
+	if (smp_part.size != 0) {
+		std::chrono::steady_clock::time_point smp_start = std::chrono::steady_clock::now();
+		smp_add_nums_to_intervals(smp_part, interval_size, min_value_data, interval_count);
+		this->update_smp_throughput(smp_part.size, std::chrono::duration<double>(std::chrono::steady_clock::now() - smp_start).count());
+		RunReport::get_instance()->add_device_chunk("SMP", "SMP", smp_part.size);
 	}
 }
 
 /*
-Assigns respective task to CL device (private).
+Assigns respective task to CL device (private). Numbers are copied into mapped input buffer of device ring, because view of the chunk is not valid after the function returns. Upload + kernel are enqueued by feeder thread of the device.
+Kernel adds moments of numbers into partials of its work-groups (if enabled), partials are read right after the kernel and reset, merged by chunk in retr_moments_res.
 */
-void Farmer::cl_add_nums_to_intervals(std::vector<double> input_nums, double interval_size, double min_value_data, cl_dev_stuff_struct* least_occ_cl_dev)
+void Farmer::cl_add_nums_to_intervals(num_span_struct input_nums_span, double interval_size, double min_value_data, cl_dev_stuff_struct* least_occ_cl_dev)
 {
-	cl::Kernel* kernel = &least_occ_cl_dev->ker_add_nums_intervals;
-
-	int input_nums_size = static_cast<int>(input_nums.size());
-	kernel->setArg(1, input_nums_size);
-	kernel->setArg(4, interval_size);
-	kernel->setArg(5, min_value_data);
-
-	least_occ_cl_dev->current_task = std::async(std::launch::async, [least_occ_cl_dev, input_nums, input_nums_size, interval_size, min_value_data]() {
-		cl::Kernel* kernel = &least_occ_cl_dev->ker_add_nums_intervals;
-		cl::CommandQueue* queue = &least_occ_cl_dev->dev_queue;
-
-		queue->enqueueWriteBuffer(least_occ_cl_dev->input_nums_buf, CL_TRUE, 0, input_nums_size * sizeof(double), input_nums.data());
-		queue->enqueueNDRangeKernel(*kernel, cl::NullRange, cl::NDRange(input_nums.size()), cl::NullRange, NULL);
-	});
+	if (input_nums_span.size == 0) { //kernel cannot be enqueued with empty range
+		return;
+	}
+	DeviceFeeder* feeder = this->cl_feeders[least_occ_cl_dev->dev_index];
+
+	size_t ring_index;
+	double* input_nums = feeder->acquire_slot(&ring_index);
+	std::copy(input_nums_span.nums, input_nums_span.nums + input_nums_span.size, input_nums); //written directly into mapped memory of device
+
+	cl_feed_task_struct task;
+	task.ring_index = ring_index;
+	task.num_count = input_nums_span.size;
+	task.input_buf_arg = 0;
+	task.input_size_arg = 1;
+	task.interval_args = true;
+	task.interval_size_recip = 1.0 / interval_size; //kernel multiplies instead of dividing
+	task.min_value_scaled = min_value_data * task.interval_size_recip;
+	task.kernel = least_occ_cl_dev->use_local_intervals ? &least_occ_cl_dev->ker_add_nums_intervals_local : &least_occ_cl_dev->ker_add_nums_intervals;
+
+	//each work-item processes at least CL_REDUCTION_NUMS_PER_ITEM numbers, count of work-groups is limited by count of partial moments on device
+	size_t group_size = least_occ_cl_dev->intervals_group_size;
+	size_t group_count = (input_nums_span.size + group_size * CL_REDUCTION_NUMS_PER_ITEM - 1) / (group_size * CL_REDUCTION_NUMS_PER_ITEM);
+	group_count = std::min<size_t>(group_count, CL_MOMENT_PARTIAL_COUNT);
+	task.global_size = group_count * group_size;
+	task.local_size = group_size;
+	if (this->calc_moments) {
+		this->cl_chunk_moments.emplace_back();
+		cl_moments_res_struct* part_res = &this->cl_chunk_moments.back();
+		part_res->chunk_index = input_nums_span.chunk_index;
+		part_res->partials.assign(group_count * 3, 0);
+		task.results.push_back({ &least_occ_cl_dev->moment_partials_buf, sizeof(double) * part_res->partials.size(), part_res->partials.data(), this->cl_moment_partials_init.data() });
+	}
+	feeder->submit(task);
 }
 
 /*
-Assigns respective task to SMP device (private).
+Assigns respective task to SMP device (private). Invalid numbers are skipped (vector check of whole block first, per number only if block contains invalid one).
+Indexes of intervals are calculated in batches without branches, numbers are counted into histogram of thread (kept for whole round, merged in retr_add_nums_to_intervals_res) / shared atomic histogram for large count of intervals.
+Moments of SMP part are stored by index of chunk (if enabled).
 */
-void Farmer::smp_add_nums_to_intervals(std::vector<double> input_nums, double interval_size, double min_value_data, int interval_count)
+void Farmer::smp_add_nums_to_intervals(num_span_struct input_nums_span, double interval_size, double min_value_data, int interval_count)
 {
-	std::vector<int> output_intervals(interval_count, 0); //output buffer
+	const double* input_nums = input_nums_span.nums;
+	double min_value_scaled = min_value_data / interval_size; //the same as before: num / interval_size - min_value_data / interval_size
+	double last_interval = interval_count - 1;
+	bool shared_intervals = this->smp_intervals_shared != nullptr;
 
-	tbb::combinable<std::vector<int>> output_intervals_combinable(output_intervals); //output of each thread
 	auto tbb_add_nums_to_intervals = [&](tbb::blocked_range<size_t> br) {
 		//local values for one block - START
-		std::vector<int>& output_intervals_local = output_intervals_combinable.local();
+		smp_intervals_vector& output_intervals_local = this->smp_intervals_local.local(); //histogram of thread, kept for whole second round
+		if (!shared_intervals && output_intervals_local.size() != static_cast<size_t>(interval_count)) { //first block processed by thread in this round
+			output_intervals_local.assign(interval_count, 0);
+		}
+		bool block_valid = ValidityFilter::find_first_invalid(input_nums + br.begin(), br.size()) == br.size(); //raw chunk may contain invalid numbers
+		int interval_indexes[SMP_INTERVAL_BATCH_NUMS];
 		//local values for one block - END
 
-		for (size_t i = br.begin(); i < br.end(); i++) { //run on more threads
-			double index_to_inc; //calc corresponding index of interval which should be increased
-			if (min_value_data < 0) { //dataset minimum is < 0
-				double part_index_1 = input_nums[i] / interval_size;
-				double part_index_2 = fabs(min_value_data) / interval_size;
-				index_to_inc = part_index_1 + part_index_2;
-			}
-			else {
-				double part_index_1 = input_nums[i] / interval_size;
-				double part_index_2 = min_value_data / interval_size;
-				index_to_inc = part_index_1 - part_index_2;
-			}
+		for (size_t batch_start = br.begin(); batch_start < br.end(); batch_start += SMP_INTERVAL_BATCH_NUMS) { //run on more threads
+			size_t batch_size = std::min<size_t>(SMP_INTERVAL_BATCH_NUMS, br.end() - batch_start);
+			const double* batch_nums = input_nums + batch_start;
 
-			if ((int)index_to_inc == interval_count) { //last interval - include upper boundary
-				int latest_valid_interv = interval_count - 1;
-				index_to_inc = latest_valid_interv;
+			for (size_t j = 0; j < batch_size; j++) { //branch-free => vectorized by compiler
+				double index_to_inc = batch_nums[j] / interval_size - min_value_scaled;
+				index_to_inc = index_to_inc > 0 ? index_to_inc : 0; //NaN gives 0 (invalid number, not counted below)
+				index_to_inc = index_to_inc < last_interval ? index_to_inc : last_interval; //last interval - include upper boundary
+				interval_indexes[j] = static_cast<int>(index_to_inc);
 			}
 
-			output_intervals_local[(int)index_to_inc] += 1;
+			if (block_valid && !shared_intervals) { //common case - all numbers counted into histogram of thread
+				for (size_t j = 0; j < batch_size; j++) {
+					output_intervals_local[interval_indexes[j]]++;
+				}
+				continue;
+			}
+			for (size_t j = 0; j < batch_size; j++) {
+				int num_class = std::fpclassify(batch_nums[j]);
+				if (!block_valid && num_class != FP_NORMAL && num_class != FP_ZERO) { //invalid number is not counted
+					continue;
+				}
+				if (shared_intervals) {
+					this->smp_intervals_shared[interval_indexes[j]].fetch_add(1, std::memory_order_relaxed);
+				}
+				else {
+					output_intervals_local[interval_indexes[j]]++;
+				}
+			}
 		}
 	};
 
-	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, input_nums.size()), tbb_add_nums_to_intervals); //execute SMP task
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, input_nums_span.size), tbb_add_nums_to_intervals); //execute SMP task, histograms are merged in retr_add_nums_to_intervals_res
 
-	//combine products of threads
-	output_intervals_combinable.combine_each([&](std::vector<int> block_result) {
-		std::transform(
-			output_intervals_combined.begin(),
-			output_intervals_combined.end(),
-			block_result.begin(),
-			output_intervals_combined.begin(),
-			std::plus<>()
-		);
-		});
+	if (this->calc_moments) { //moments of SMP part (vectorized), numbers are compacted only if part contains invalid one
+		num_span_struct valid_span = input_nums_span;
+		if (ValidityFilter::find_first_invalid(input_nums_span.nums, input_nums_span.size) != input_nums_span.size) {
+			this->smp_valid_nums.resize(input_nums_span.size);
+			valid_span.nums = this->smp_valid_nums.data();
+			valid_span.size = ValidityFilter::compact_valid(input_nums_span.nums, input_nums_span.size, this->smp_valid_nums.data());
+		}
+		if (this->smp_chunk_moments.size() <= input_nums_span.chunk_index) {
+			this->smp_chunk_moments.resize(input_nums_span.chunk_index + 1);
+		}
+		this->smp_chunk_moments[input_nums_span.chunk_index] = StatsKernel::calc_moments(valid_span.nums, valid_span.size, this->normalize_val);
+	}
 }
 
 /*
 Returns relevant results from second round of algorithm. Ie. gets data from all computing devices and adds count of occurrences for each interval (across devices).
-std::vector<int>* output_intervals = global occurrences for each interval
+std::vector<long long>* output_intervals = global occurrences for each interval
 int interval_count = count of created intervals
 */
-void Farmer::retr_add_nums_to_intervals_res(std::vector<int>* output_intervals, int interval_count) {
-	//add openCL results (SMP already added on every chunk job finish)
+void Farmer::retr_add_nums_to_intervals_res(std::vector<long long>* output_intervals, int interval_count) {
+	//add SMP results - histogram of each thread / shared histogram, merged once per round
+	this->smp_intervals_local.combine_each([&](const smp_intervals_vector& thread_intervals) {
+		for (size_t i = 0; i < thread_intervals.size(); i++) {
+			output_intervals_combined[i] += thread_intervals[i];
+		}
+	});
+	if (this->smp_intervals_shared != nullptr) {
+		for (int i = 0; i < interval_count; i++) {
+			output_intervals_combined[i] += this->smp_intervals_shared[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	//add openCL results
 	for (int i = 0; i < this->cl_devices.size(); i++) { //go through available devices and find least occupied / free
 		cl_dev_stuff_struct* one_cl_dev = &this->cl_devices[i];
 		cl::CommandQueue* queue = &one_cl_dev->dev_queue;
-		one_cl_dev->current_task.wait(); //wait for all tasks to complete
+		this->cl_feeders[i]->finish(); //wait for all tasks to complete
 
-		std::vector<int> output_intervals_cl(interval_count, 0); //results from one device
-		queue->enqueueReadBuffer(one_cl_dev->output_intervals_buf, CL_TRUE, 0, interval_count * sizeof(int), output_intervals_cl.data());
+		std::vector<cl_ulong> output_intervals_cl(interval_count, 0); //results from one device
+		queue->enqueueReadBuffer(one_cl_dev->output_intervals_buf, CL_TRUE, 0, interval_count * sizeof(cl_ulong), output_intervals_cl.data());
 
 		std::transform(
 			output_intervals_combined.begin(),
@@ -467,4 +658,55 @@ void Farmer::retr_add_nums_to_intervals_res(std::vector<int>* output_intervals,
 	}
 
 	*output_intervals = output_intervals_combined;
-}
\ No newline at end of file
+}
+
+/*
+Returns moments of dataset calculated during second round of algorithm. Parts are merged in order of chunks - OpenCL parts of chunk (order of assignment, work-groups in order), then SMP part of the chunk.
+Chunks may be assigned out of order (more reader threads), so OpenCL parts are sorted by chunk first. Result thus does not depend on timing for given split of chunks (see split_by_throughput).
+moments_struct* res_moments = count, mean, M2 of valid numbers (divided by value used for normalization)
+*/
+void Farmer::retr_moments_res(moments_struct* res_moments) {
+	for (size_t i = 0; i < this->cl_devices.size(); i++) {
+		this->cl_feeders[i]->finish(); //wait for all tasks to complete (partials are read after each kernel)
+	}
+
+	std::stable_sort(this->cl_chunk_moments.begin(), this->cl_chunk_moments.end(), [](const cl_moments_res_struct& part_1, const cl_moments_res_struct& part_2) {
+		return part_1.chunk_index < part_2.chunk_index; //parts of one chunk stay in order of assignment
+	});
+
+	moments_struct moments;
+	size_t smp_chunk = 0; //next SMP part to be merged
+	for (size_t i = 0; i < this->cl_chunk_moments.size(); i++) { //ascending chunk indexes
+		const cl_moments_res_struct& part_res = this->cl_chunk_moments[i];
+		for (; smp_chunk < part_res.chunk_index && smp_chunk < this->smp_chunk_moments.size(); smp_chunk++) { //SMP parts of previous chunks
+			StatsKernel::merge_moments(&moments, this->smp_chunk_moments[smp_chunk]);
+		}
+		for (size_t j = 0; j < part_res.partials.size() / 3; j++) {
+			moments_struct group_moments;
+			group_moments.count = static_cast<long long>(part_res.partials[j * 3]);
+			group_moments.mean = part_res.partials[j * 3 + 1];
+			group_moments.m2 = part_res.partials[j * 3 + 2];
+			StatsKernel::merge_moments(&moments, group_moments);
+		}
+	}
+	for (; smp_chunk < this->smp_chunk_moments.size(); smp_chunk++) {
+		StatsKernel::merge_moments(&moments, this->smp_chunk_moments[smp_chunk]);
+	}
+	this->smp_chunk_moments.clear();
+	this->cl_chunk_moments.clear();
+
+	*res_moments = moments;
+}
+
+/*
+Passes smoothed throughput of each OpenCL device and SMP (measured by scheduler) to run report.
+*/
+void Farmer::report_throughput()
+{
+	for (size_t i = 0; i < this->cl_feeders.size(); i++) {
+		RunReport::get_instance()->set_device_throughput(this->cl_dev_keys[i], this->cl_dev_names[i], this->cl_feeders[i]->get_throughput());
+	}
+	if (this->cl_devices.size() == 0 || this->sel_comp_type != OPENCL) { //SMP took part in computation
+		RunReport::get_instance()->set_device_throughput("SMP", "SMP", this->smp_throughput);
+	}
+}
@@ -1,6 +1,11 @@
 #pragma once
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <deque>
 #if __has_include(<CL/opencl.hpp>)
 # include <CL/opencl.hpp>
 #else
@@ -8,9 +13,14 @@
 #endif
 #include "Structures.h"
 #include "const.h"
+#include "DeviceFeeder.h"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
 #include "tbb/combinable.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/cache_aligned_allocator.h"
+
+typedef std::vector<long long, tbb::cache_aligned_allocator<long long>> smp_intervals_vector; //interval counters of one SMP thread (starts on cache line => no false sharing between threads)
 
 //detects least occupied devices and assigns work
 class Farmer
@@ -18,25 +28,47 @@ class Farmer
 	private:
 		compute_type sel_comp_type; //selected type of computation - smp, all, spec. OpenCL devices
 		std::vector<cl_dev_stuff_struct> cl_devices; //OpenCL devices on which computing should be performed
+		std::vector<DeviceFeeder*> cl_feeders; //feeder thread of each OpenCL device (same order as cl_devices)
+		std::vector<std::string> cl_dev_names; //name of each OpenCL device used in run report (same order as cl_devices)
+		std::vector<std::string> cl_dev_keys; //name + index of each OpenCL device, identifies device in run report (identical devices have the same name)
+		std::mutex sched_mutex; //used for waiting until some OpenCL device is free (OpenCL only computation)
+		std::condition_variable sched_cond; //notified by feeders when kernel completes
+		double smp_throughput; //smoothed count of numbers processed by SMP per second (0 = not measured yet)
 
-		tbb::enumerable_thread_specific<double> min_value_global; //minimum value for each SMP device
-		tbb::enumerable_thread_specific<double> max_value_global; //maximum value for each SMP device
-		tbb::enumerable_thread_specific<bool> dec_point_num_global; //thread found decimal point number flag - SMP
-		tbb::enumerable_thread_specific<bool> negative_num_global; //thread found negative number flag - SMP
-		std::vector<int> output_intervals_combined; //counters for each interval - SMP
+		tbb::enumerable_thread_specific<block_stats_struct> first_pass_stats_global; //min, max, valid count, decimal point / negative number flags for each SMP thread
+		bool keep_chunk_stats; //true if first round keeps statistics of each chunk as well (block index)
+		std::vector<block_stats_struct> chunk_first_pass_stats; //statistics of each chunk (index = chunk index), only if keep_chunk_stats
+		std::deque<cl_first_pass_res_struct> cl_chunk_first_pass_res; //results of OpenCL parts of chunks read after each kernel (deque - read target does not move), only if keep_chunk_stats
+		cl_first_pass_res_struct cl_first_pass_init; //initial values of first round result buffers
+		std::vector<long long> output_intervals_combined; //counters for each interval - all devices
+		tbb::enumerable_thread_specific<smp_intervals_vector> smp_intervals_local; //counters for each interval of each SMP thread, kept for whole second round
+		std::unique_ptr<std::atomic<long long>[]> smp_intervals_shared; //counters for each interval shared by SMP threads, used instead of smp_intervals_local for large count of intervals
+		bool calc_moments; //true if second round calculates moments (average + variance) of dataset as well
+		double normalize_val; //each number is divided by this value before moments are calculated (see DecisionDist normalization)
+		std::vector<moments_struct> smp_chunk_moments; //moments of numbers processed by SMP in each chunk (index = chunk index) - SMP
+		std::deque<cl_moments_res_struct> cl_chunk_moments; //partial moments of OpenCL parts of chunks read after each kernel, in order of assignment (deque - read target does not move)
+		std::vector<double> cl_moment_partials_init; //zeroed partials written back after each kernel
+		std::vector<double> smp_valid_nums; //valid numbers of SMP part, used only if part contains invalid numbers
 
-		void cl_min_max_dec_point_neg_num(std::vector<double> input_nums, cl_dev_stuff_struct* least_occ_cl_dev); //assign the job to OpenCL device
-		void smp_min_max_dec_point_neg_num(std::vector<double> input_nums); //assign the job to SMP device
-		void cl_add_nums_to_intervals(std::vector<double> input_nums, double interval_size, double min_value_data, cl_dev_stuff_struct* least_occ_cl_dev); //assign the job to OpenCL device
-		void smp_add_nums_to_intervals(std::vector<double> input_nums, double interval_size, double min_value_data, int interval_count); //assign the job to SMP device
+		std::vector<cl_dev_stuff_struct*> wait_free_cl_devices(); //gets free OpenCL devices, waits for one if only OpenCL is allowed
+		void split_by_throughput(num_span_struct input_nums, std::vector<cl_dev_stuff_struct*>& free_cl_devs, std::vector<num_span_struct>* cl_parts, num_span_struct* smp_part); //splits numbers between devices according to their throughput
+		void update_smp_throughput(size_t num_count, double secs); //updates measured throughput of SMP
+		void cl_min_max_dec_point_neg_num(num_span_struct input_nums, cl_dev_stuff_struct* least_occ_cl_dev); //assign the job to OpenCL device
+		void smp_min_max_dec_point_neg_num(num_span_struct input_nums); //assign the job to SMP device
+		void cl_add_nums_to_intervals(num_span_struct input_nums, double interval_size, double min_value_data, cl_dev_stuff_struct* least_occ_cl_dev); //assign the job to OpenCL device
+		void smp_add_nums_to_intervals(num_span_struct input_nums, double interval_size, double min_value_data, int interval_count); //assign the job to SMP device
 	public:
-		Farmer(compute_type sel_comp_type, std::vector<cl_dev_stuff_struct> compute_cl_devices); //constructor expects selected computing type + vector with allowed OpenCL devices
+		Farmer(compute_type sel_comp_type, std::vector<cl_dev_stuff_struct> compute_cl_devices); //constructor expects selected computing type + vector with allowed OpenCL devices, starts feeder thread for each device
+		~Farmer(); //stops feeder threads
 		std::vector<cl_dev_stuff_struct*> get_free_cl_devices(); //gets OpenCL devices which are not processing any data
-		void prep_devs_min_max_dec_point_neg_num(double init_min_max_val); //init OpenCL + SMP for first round of algorithm
-		void prep_devs_intervals(int interval_count); //init OpenCL + SMP for second round of algorithm
-		void assign_min_max_dec_point_neg_num(std::vector<double> input_nums); //checks whether value is decimal / negative (useful for check if exponential + Poisson) + checks for minimum / maximum value
-		void retr_min_max_dec_point_neg_num_res(double* res_min_value, double* res_max_value, bool* res_dec_point_num, bool* res_negative_num); //gets results of first round of algorithm
-		void assign_add_nums_to_intervals(std::vector<double> input_nums, double interval_size, double min_value_data, int interval_count); //assign the job (second round of algorithm)
-		void retr_add_nums_to_intervals_res(std::vector<int>* output_intervals, int interval_count); //get result of the job (second round of algorithm)
+		void prep_devs_min_max_dec_point_neg_num(bool keep_chunk_stats); //init OpenCL + SMP for first round of algorithm, statistics of each chunk are kept if requested
+		void prep_devs_intervals(int interval_count, bool calc_moments, double normalize_val); //init OpenCL + SMP for second round of algorithm
+		void assign_min_max_dec_point_neg_num(num_span_struct input_nums); //checks whether value is decimal / negative (useful for check if exponential + Poisson) + checks for minimum / maximum value, invalid numbers are skipped
+		void retr_min_max_dec_point_neg_num_res(double* res_min_value, double* res_max_value, bool* res_dec_point_num, bool* res_negative_num, long long* res_count); //gets results of first round of algorithm
+		std::vector<block_stats_struct> retr_chunk_first_pass_stats(); //gets statistics of each chunk from first round (after retr_min_max_dec_point_neg_num_res)
+		void assign_add_nums_to_intervals(num_span_struct input_nums, double interval_size, double min_value_data, int interval_count); //assign the job (second round of algorithm)
+		void retr_add_nums_to_intervals_res(std::vector<long long>* output_intervals, int interval_count); //get result of the job (second round of algorithm)
+		void retr_moments_res(moments_struct* res_moments); //get moments of dataset calculated during second round of algorithm
+		void report_throughput(); //passes measured throughput of each device to run report
 };
 
@@ -2,8 +2,22 @@
 #include <iostream>
 #include <fstream>
 #include "FileHelper.h"
+#include "const.h"
+#include "ValidityFilter.h"
 #include <cstdint>
 #include <filesystem>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 /*
 Constructor takes name of file which should be parsed. File should contain 64bit doubles.
@@ -11,13 +25,98 @@ std::string file_name = name of file to parse
 */
 FileHelper::FileHelper(std::string file_name) {
     this->file_name = file_name;
+    this->input_file_pointer = NULL;
+    this->stream_input = file_name == STDIN_FILE_NAME;
+    this->mmap_read = false;
+    this->file_mapped = false;
+    this->mapped_file = NULL;
+    this->mapped_file_size = 0;
+    this->direct_read = false;
+    this->direct_file_desc = -1;
+    this->direct_read_buffer = NULL;
+    this->direct_read_buffer_count = 0;
 }
 
 /*
-Opens file for reading (in binary mode).
+Destructor frees aligned buffer of get_part_file and pool of aligned buffers used by unaligned direct I/O reads.
+*/
+FileHelper::~FileHelper() {
+    this->free_read_buffer(this->direct_read_buffer);
+    for (size_t i = 0; i < this->bounce_bufs.size(); i++) {
+        this->free_read_buffer(static_cast<double*>(this->bounce_bufs[i].first));
+    }
+}
+
+/*
+Enables / disables reading of input file using memory mapping. When enabled, chunks retrieved by get_part_file point directly to mapped file pages (no copy, no allocation).
+bool mmap_read = true if file should be memory mapped
+*/
+void FileHelper::set_mmap_read(bool mmap_read) {
+    this->mmap_read = mmap_read;
+}
+
+/*
+Enables / disables reading of input file using direct I/O. Reads then go straight from device into (aligned) buffers, page cache is not filled with content of file - useful for files larger than memory.
+bool direct_read = true if file should be read using direct I/O
+*/
+void FileHelper::set_direct_read(bool direct_read) {
+    this->direct_read = direct_read;
+}
+
+/*
+Allocates buffer for given count of doubles. Buffer address is aligned to DIRECT_IO_ALIGNMENT and its size is rounded up to multiple of DIRECT_IO_ALIGNMENT, so it can be filled by direct I/O without copy.
+size_t number_count = count of doubles which should fit into buffer
+return = allocated buffer, must be freed using free_read_buffer (NULL if there is not enough memory)
+*/
+double* FileHelper::alloc_read_buffer(size_t number_count) {
+    size_t buffer_size = ((number_count * sizeof(double) + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT) * DIRECT_IO_ALIGNMENT;
+#ifdef _WIN32
+    return static_cast<double*>(_aligned_malloc(buffer_size, DIRECT_IO_ALIGNMENT));
+#else
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, DIRECT_IO_ALIGNMENT, buffer_size) != 0) {
+        return NULL;
+    }
+    return static_cast<double*>(buffer);
+#endif
+}
+
+/*
+Frees buffer previously allocated using alloc_read_buffer.
+double* buffer = buffer to free
+*/
+void FileHelper::free_read_buffer(double* buffer) {
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+}
+
+/*
+Opens file for reading (in binary mode). If memory mapped reading is enabled, file is mapped instead. When mapping fails, regular fread is used.
 return = true if file opened successfully, else false (wrong permissions / not existing file etc.)
 */
 bool FileHelper::open_file_read() {
+    if (this->stream_input) { //standard input is already opened
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        this->input_file_pointer = stdin;
+        return true;
+    }
+
+    if (this->mmap_read) {
+        if (this->map_file_read()) { //mapped ok, FILE* not needed
+            return true;
+        }
+        std::cout << "WARNING: Memory mapping of file " << this->file_name << " failed, using regular read instead." << std::endl;
+    }
+
+    if (this->direct_read && this->open_file_direct() == false) {
+        std::cout << "WARNING: Direct I/O is not supported for file " << this->file_name << ", using regular read instead." << std::endl;
+    }
+
     this->input_file_pointer = fopen(this->file_name.c_str(), FILE_READ_MODE); //open file for reading in binary mode
     if (this->input_file_pointer == NULL) { //error while opening file in bin mode
         return false;
@@ -31,6 +130,21 @@ bool FileHelper::open_file_read() {
 Closes input file which was previously opened for reading purposes.
 */
 bool FileHelper::close_file_read() {
+    if (this->file_mapped) { //mapped, no FILE* opened
+        this->unmap_file_read();
+        return true;
+    }
+    if (this->stream_input) { //standard input is not closed, nothing more can be read anyway
+        return true;
+    }
+
+#ifndef _WIN32
+    if (this->direct_file_desc != -1) {
+        close(this->direct_file_desc);
+        this->direct_file_desc = -1;
+    }
+#endif
+
     if (fclose(this->input_file_pointer) != 0){ //error while closing file
         return false;
     }
@@ -40,27 +154,319 @@ bool FileHelper::close_file_read() {
 }
 
 /*
-Reads part of file specified by arguments into buffer and returns vector object with desired content.
-size_t start_offset = file offset from which reading should be performed
-size_t number_count = number of doubles which should be retrieved from file; read sizeof(double) * number_count
-return = vector with data retrieved from file
+Moves file pointer of input file to given offset. fseek takes long, which is only 32-bit on Windows, so 64-bit variant is used (files > 2 GiB).
+uintmax_t start_offset = file offset to which pointer should be moved
+*/
+void FileHelper::seek_file(uintmax_t start_offset) {
+#ifdef _WIN32
+    _fseeki64(input_file_pointer, static_cast<long long>(start_offset), SEEK_SET);
+#else
+    fseeko(input_file_pointer, static_cast<off_t>(start_offset), SEEK_SET);
+#endif
+}
+
+/*
+Returns read only view of specified part of the file. If file is memory mapped, view points directly into mapping. Else the numbers are read into buffer which is reused on every call.
+View is valid until next call of this function (or until file is closed).
+uintmax_t start_offset = file offset from which reading should be performed
+size_t number_count = number of doubles which should be retrieved from file
+return = view of numbers retrieved from file
 */
-std::vector<double> FileHelper::read_part_file(size_t start_offset, size_t number_count) {
-    std::vector<double> byte_buffer(number_count, 0);
-    fseek(input_file_pointer, static_cast<long>(start_offset), SEEK_SET); //move file pointer to desired position
-    fread(&byte_buffer[0], sizeof(double), number_count, input_file_pointer);
+num_span_struct FileHelper::get_part_file(uintmax_t start_offset, size_t number_count) {
+    num_span_struct file_nums;
 
-    return byte_buffer;
+    if (this->file_mapped) {
+        file_nums.nums = reinterpret_cast<const double*>(static_cast<const char*>(this->mapped_file) + start_offset);
+        file_nums.size = number_count;
+        return file_nums;
+    }
+
+    if (this->direct_file_desc != -1) { //direct I/O, buffer must be aligned
+        if (this->direct_read_buffer_count < number_count) { //allocated only on first call (chunk size is the same for whole file)
+            this->free_read_buffer(this->direct_read_buffer);
+            this->direct_read_buffer = this->alloc_read_buffer(number_count);
+            this->direct_read_buffer_count = this->direct_read_buffer == NULL ? 0 : number_count;
+            if (this->direct_read_buffer == NULL) { //nothing read, caller detects short read
+                std::cout << "ERROR: Buffer for reading of file " << this->file_name << " could not be allocated (not enough memory)." << std::endl;
+                file_nums.size = 0;
+                return file_nums;
+            }
+        }
+        file_nums.size = this->read_part_file_direct(start_offset, number_count, this->direct_read_buffer);
+        file_nums.nums = this->direct_read_buffer;
+        return file_nums;
+    }
+
+    if (this->read_buffer.size() < number_count) { //grows only on first call (chunk size is the same for whole file)
+        this->read_buffer.resize(number_count);
+    }
+    if (!this->stream_input) { //stream cannot be seeked, parts are always requested in order
+        this->seek_file(start_offset); //move file pointer to desired position
+    }
+    file_nums.size = fread(this->read_buffer.data(), sizeof(double), number_count, input_file_pointer);
+    file_nums.nums = this->read_buffer.data();
+
+    return file_nums;
+}
+
+/*
+Reads specified part of the file into given buffer. On POSIX systems pread is used, so file pointer is not moved and function can be called from other thread than the one which opened the file.
+uintmax_t start_offset = file offset from which reading should be performed
+size_t number_count = number of doubles which should be read
+double* buffer = output buffer, must have space for number_count doubles
+return = count of doubles which were actually read (lower than number_count on error / end of file)
+*/
+size_t FileHelper::read_part_file_into(uintmax_t start_offset, size_t number_count, double* buffer) {
+    if (this->file_mapped) {
+        memcpy(buffer, static_cast<const char*>(this->mapped_file) + start_offset, number_count * sizeof(double));
+        return number_count;
+    }
+    if (this->stream_input) { //stream can be read only sequentially, start_offset is always the current position
+        return fread(buffer, sizeof(double), number_count, this->input_file_pointer);
+    }
+
+#ifndef _WIN32
+    if (this->direct_file_desc != -1) {
+        return this->read_part_file_direct(start_offset, number_count, buffer);
+    }
+
+    int file_desc = fileno(this->input_file_pointer);
+    size_t total_bytes = number_count * sizeof(double);
+    size_t read_bytes = 0;
+    while (read_bytes < total_bytes) { //pread can return less than requested, continue until all read
+        ssize_t part_bytes = pread(file_desc, reinterpret_cast<char*>(buffer) + read_bytes, total_bytes - read_bytes, static_cast<off_t>(start_offset + read_bytes));
+        if (part_bytes <= 0) { //error / end of file
+            break;
+        }
+        read_bytes += static_cast<size_t>(part_bytes);
+    }
+    return read_bytes / sizeof(double);
+#else
+    std::unique_lock<std::mutex> uniq_mutex(this->seek_read_mutex); //several reader threads share one file position
+    this->seek_file(start_offset);
+    return fread(buffer, sizeof(double), number_count, input_file_pointer);
+#endif
+}
+
+/*
+Opens input file for direct I/O - O_DIRECT (Linux) or F_NOCACHE (macOS).
+return = true if file opened, else false (not supported by platform / file system)
+*/
+bool FileHelper::open_file_direct() {
+#if defined(O_DIRECT)
+    this->direct_file_desc = open(this->file_name.c_str(), O_RDONLY | O_DIRECT);
+#elif defined(F_NOCACHE)
+    this->direct_file_desc = open(this->file_name.c_str(), O_RDONLY);
+    if (this->direct_file_desc != -1 && fcntl(this->direct_file_desc, F_NOCACHE, 1) == -1) {
+        close(this->direct_file_desc);
+        this->direct_file_desc = -1;
+    }
+#else
+    this->direct_file_desc = -1;
+#endif
+    return this->direct_file_desc != -1;
+}
+
+/*
+Reads specified part of file using direct I/O. Offset, length and buffer address must be multiple of DIRECT_IO_ALIGNMENT.
+If the request is aligned (usual case if chunk size is multiple of alignment), data are read directly into given buffer. Else (unaligned offset, final partial chunk) aligned range covering the request is read into buffer from pool and requested part is copied out.
+uintmax_t start_offset = file offset from which reading should be performed
+size_t number_count = number of doubles which should be read
+double* buffer = output buffer, must have space for number_count doubles
+return = count of doubles which were actually read (lower than number_count on error / end of file)
+*/
+size_t FileHelper::read_part_file_direct(uintmax_t start_offset, size_t number_count, double* buffer) {
+#ifndef _WIN32
+    uintmax_t aligned_start = start_offset - (start_offset % DIRECT_IO_ALIGNMENT);
+    size_t head_bytes = static_cast<size_t>(start_offset - aligned_start); //part of first aligned block before requested offset
+    size_t total_bytes = ((head_bytes + number_count * sizeof(double) + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT) * DIRECT_IO_ALIGNMENT;
+
+    bool aligned = head_bytes == 0 && total_bytes == number_count * sizeof(double) && reinterpret_cast<uintptr_t>(buffer) % DIRECT_IO_ALIGNMENT == 0;
+    std::pair<void*, size_t> bounce_buf(NULL, 0);
+    if (!aligned) { //take aligned buffer from pool (allocated only when pool is empty / buffer too small)
+        std::unique_lock<std::mutex> uniq_mutex(this->bounce_bufs_mutex);
+        if (!this->bounce_bufs.empty()) {
+            bounce_buf = this->bounce_bufs.back();
+            this->bounce_bufs.pop_back();
+        }
+        uniq_mutex.unlock();
+
+        if (bounce_buf.second < total_bytes) {
+            this->free_read_buffer(static_cast<double*>(bounce_buf.first));
+            bounce_buf = std::make_pair(static_cast<void*>(this->alloc_read_buffer(total_bytes / sizeof(double))), total_bytes);
+            if (bounce_buf.first == NULL) { //nothing read, caller detects short read
+                std::cout << "ERROR: Buffer for reading of file " << this->file_name << " could not be allocated (not enough memory)." << std::endl;
+                return 0;
+            }
+        }
+    }
+
+    char* read_target = aligned ? reinterpret_cast<char*>(buffer) : static_cast<char*>(bounce_buf.first);
+    size_t read_bytes = 0;
+    while (read_bytes < total_bytes) {
+        ssize_t part_bytes = pread(this->direct_file_desc, read_target + read_bytes, total_bytes - read_bytes, static_cast<off_t>(aligned_start + read_bytes));
+        if (part_bytes <= 0) { //error / end of file
+            break;
+        }
+        read_bytes += static_cast<size_t>(part_bytes);
+        if (part_bytes % DIRECT_IO_ALIGNMENT != 0) { //end of file reached (non aligned tail of file), next read would be unaligned
+            break;
+        }
+    }
+
+    if (aligned) {
+        return read_bytes / sizeof(double);
+    }
+
+    size_t copy_bytes = read_bytes > head_bytes ? std::min(read_bytes - head_bytes, number_count * sizeof(double)) : 0;
+    memcpy(buffer, read_target + head_bytes, copy_bytes);
+
+    std::unique_lock<std::mutex> uniq_mutex(this->bounce_bufs_mutex);
+    this->bounce_bufs.push_back(bounce_buf); //return buffer to pool
+    return copy_bytes / sizeof(double);
+#else
+    return 0; //direct I/O not opened on this platform
+#endif
+}
+
+/*
+Tells kernel that specified part of memory mapped file will be needed soon, so pages are read in background. Does nothing if file is not mapped.
+uintmax_t start_offset = file offset of the part
+size_t number_count = number of doubles in the part
+*/
+void FileHelper::prefetch_part_file(uintmax_t start_offset, size_t number_count) {
+#ifndef _WIN32
+    if (!this->file_mapped || start_offset >= this->mapped_file_size) {
+        return;
+    }
+
+    uintmax_t page_size = static_cast<uintmax_t>(sysconf(_SC_PAGESIZE));
+    uintmax_t aligned_offset = start_offset - (start_offset % page_size); //madvise requires page aligned address
+    size_t length = static_cast<size_t>(std::min<uintmax_t>(start_offset + number_count * sizeof(double), this->mapped_file_size) - aligned_offset);
+    madvise(static_cast<char*>(this->mapped_file) + aligned_offset, length, MADV_WILLNEED);
+#endif
+}
+
+/*
+Tells whether numbers are read from standard input (stream, not regular file).
+*/
+bool FileHelper::is_stream_input() {
+    return this->stream_input;
+}
+
+/*
+Tells whether file is currently memory mapped.
+*/
+bool FileHelper::is_file_mapped() {
+    return this->file_mapped;
+}
+
+/*
+Returns view which contains only valid numbers from given chunk. If every number in chunk is valid (usual case), the original view is returned and nothing is copied.
+Else valid numbers are compacted into given buffer (size is kept between calls, no push_back) and view of the buffer is returned. Checks are done by vectorized ValidityFilter.
+num_span_struct file_nums = numbers retrieved from file
+std::vector<double>* valid_nums = buffer used when chunk contains invalid numbers
+return = view with valid numbers only
+*/
+num_span_struct FileHelper::filter_valid_nums(num_span_struct file_nums, std::vector<double>* valid_nums) {
+    size_t first_invalid = ValidityFilter::find_first_invalid(file_nums.nums, file_nums.size);
+    if (first_invalid == file_nums.size) { //all valid, no copy required
+        return file_nums;
+    }
+
+    if (valid_nums->size() < file_nums.size) { //grows only on first chunk with invalid number
+        valid_nums->resize(file_nums.size);
+    }
+    memcpy(valid_nums->data(), file_nums.nums, first_invalid * sizeof(double));
+    size_t valid_count = first_invalid + ValidityFilter::compact_valid(file_nums.nums + first_invalid + 1, file_nums.size - first_invalid - 1, valid_nums->data() + first_invalid);
+
+    num_span_struct valid_span;
+    valid_span.nums = valid_nums->data();
+    valid_span.size = valid_count;
+    valid_span.chunk_index = file_nums.chunk_index;
+    return valid_span;
+}
+
+/*
+Maps whole input file into memory (read only) and informs kernel that file will be read sequentially.
+return = true if file mapped successfully, else false (mapping not supported on platform, empty file...)
+*/
+bool FileHelper::map_file_read() {
+#ifndef _WIN32
+    int file_desc = open(this->file_name.c_str(), O_RDONLY);
+    if (file_desc == -1) {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(file_desc, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(file_desc);
+        return false;
+    }
+
+    void* mapping = mmap(NULL, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_desc, 0);
+    close(file_desc); //mapping stays valid after descriptor is closed
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    madvise(mapping, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL); //aggressive read ahead, pages can be dropped soon after read
+
+    this->mapped_file = mapping;
+    this->mapped_file_size = static_cast<size_t>(file_stat.st_size);
+    this->file_mapped = true;
+    return true;
+#else
+    return false; //mmap not available, caller falls back to fread
+#endif
+}
+
+/*
+Unmaps file which was mapped using map_file_read.
+*/
+void FileHelper::unmap_file_read() {
+#ifndef _WIN32
+    munmap(this->mapped_file, this->mapped_file_size);
+#endif
+    this->mapped_file = NULL;
+    this->mapped_file_size = 0;
+    this->file_mapped = false;
 }
 
 /*
 Determines size of input file. Size is used later for calculation of total read count from file.
 */
 std::uintmax_t FileHelper::deter_file_size() {
+    if (this->stream_input) { //size of stream is not known in advance
+        return 0;
+    }
     std::uintmax_t size = std::filesystem::file_size(this->file_name);
     return size;
 }
 
+/*
+Determines time of last modification of input file. Value is meant only for comparison with value from previous run (eg. validity of block index).
+*/
+long long FileHelper::deter_file_mtime() {
+    return static_cast<long long>(std::filesystem::last_write_time(this->file_name).time_since_epoch().count());
+}
+
+/*
+Calculates 64bit FNV-1a hash of given data. Hash is stable across runs and platforms, so it can be stored on disk.
+const void* data = data to hash
+size_t size = size of data in bytes
+uint64_t hash = hash of previous data (continue hashing), FNV_HASH_OFFSET for new hash
+return = updated hash
+*/
+uint64_t FileHelper::calc_hash(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_HASH_PRIME;
+    }
+    return hash;
+}
+
 /*
 Checks if given number is considered as valid in terms of semestral project. Ie. function std::fpclassify(num) returns FP_NORMAL or FP_ZERO.
 double num = number from dataset to check
@@ -2,6 +2,10 @@
 #pragma warning(disable:4996)
 #define FILE_READ_MODE "rb"
 #include <vector>
+#include <string>
+#include <cstdint>
+#include <mutex>
+#include "Structures.h"
 
 //tools regarding to file read
 class FileHelper {
@@ -11,13 +15,46 @@ class FileHelper {
         //constructor variables - END
 
         FILE* input_file_pointer; //pointer to file which should be parsed
+        std::vector<double> read_buffer; //buffer reused for every chunk read by fread (mmap not used)
+
+        bool stream_input; //true if numbers are read from standard input (not seekable, sequential read only)
+        bool mmap_read; //true if file should be memory mapped instead of read using fread
+        bool file_mapped; //true if file is currently mapped into memory
+        void* mapped_file; //start of memory mapped file
+        size_t mapped_file_size; //size of mapped region in bytes
+
+        bool direct_read; //true if file should be read using direct I/O (page cache bypassed)
+        int direct_file_desc; //descriptor of file opened for direct I/O (-1 if not opened)
+        double* direct_read_buffer; //aligned buffer used by get_part_file when direct I/O is used
+        size_t direct_read_buffer_count; //capacity of direct_read_buffer (in doubles)
+        std::vector<std::pair<void*, size_t>> bounce_bufs; //pool of aligned buffers (address + size in bytes) for reads which are not aligned
+        std::mutex bounce_bufs_mutex; //guards pool of aligned buffers
+        std::mutex seek_read_mutex; //guards seek + read pair where positional read (pread) is not available
+
+        bool map_file_read(); //maps whole file into memory (read only)
+        void unmap_file_read(); //unmaps previously mapped file
+        bool open_file_direct(); //opens file for direct I/O
+        size_t read_part_file_direct(uintmax_t start_offset, size_t number_count, double* buffer); //reads part of file using direct I/O, unaligned parts through aligned buffer from pool
+        void seek_file(uintmax_t start_offset); //moves file pointer to given offset (64-bit offset on all platforms)
 
     public:
         FileHelper(std::string file_name); //constructor expects just name of the file to read
-        bool open_file_read(); //opens in rb mode
+        ~FileHelper(); //frees aligned buffers used for direct I/O
+        void set_mmap_read(bool mmap_read); //enables / disables memory mapped reading
+        void set_direct_read(bool direct_read); //enables / disables direct I/O reading
+        double* alloc_read_buffer(size_t number_count); //allocates buffer usable for direct I/O (aligned, size rounded up)
+        void free_read_buffer(double* buffer); //frees buffer allocated by alloc_read_buffer
+        bool open_file_read(); //opens in rb mode (or maps file if mmap enabled)
         bool close_file_read(); //closes file
-        std::vector<double> read_part_file(size_t start_offset, size_t number_count); //read specified part of the file
+        num_span_struct get_part_file(uintmax_t start_offset, size_t number_count); //get read only view of specified part of the file, no allocation per call
+        size_t read_part_file_into(uintmax_t start_offset, size_t number_count, double* buffer); //read specified part of the file into given buffer (thread safe, does not move file pointer)
+        void prefetch_part_file(uintmax_t start_offset, size_t number_count); //hint that specified part of mapped file will be needed soon
+        bool is_file_mapped(); //true if file is currently memory mapped
+        bool is_stream_input(); //true if numbers are read from standard input
+        num_span_struct filter_valid_nums(num_span_struct file_nums, std::vector<double>* valid_nums); //returns view with valid numbers only, compacts only if invalid number present
         std::uintmax_t deter_file_size(); //gets file size
+        long long deter_file_mtime(); //gets time of last file modification (as number, usable for comparison only)
+        static uint64_t calc_hash(const void* data, size_t size, uint64_t hash); //FNV-1a hash of given data, continues from given hash
         bool is_valid_num(double num); //check if number is considered as valid (std::fpclassify is FP_NORMAL / FP_ZERO)
         std::string get_file_name(); //gets name of the file
 };
\ No newline at end of file
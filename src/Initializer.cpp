@@ -7,6 +7,9 @@
 #include <fstream>
 #include <filesystem>
 #include "Farmer.h"
+#include "const.h"
+#include "ValidityFilter.h"
+#include <climits>
 
 /*
 Constructor accepts values specified by user at program execution.
@@ -29,12 +32,17 @@ returns = true if arguments are valid (init successful), else false
 */
 bool Initializer::init_via_args()
 {
+	if (this->parse_opt_args() == false) { //unknown option given
+		return false;
+	}
+
 	if (this->argc < 3) { //checks args count, must be >= 3
-		std::cout << "ERROR: Invalid number of arguments. Usage: \"pprsolver.exe file processor[all | SMP | opencl_device_name]\"";
+		std::cout << "ERROR: Invalid number of arguments. ";
+		this->print_usage();
 		return false;
 	}
 
-	if(is_file_available(argv[1]) == false) { //args count ok, check file existence
+	if(!this->run_settings.stream_input && is_file_available(argv[1]) == false) { //args count ok, check file existence (streamed input is not file)
 		std::cout << "ERROR: File with name " << argv[1] << " does not exist!";
 		return false;
 	}
@@ -67,7 +75,8 @@ bool Initializer::init_via_args()
 			std::istringstream string_str(argv[2]); //convert input with desired computing devices into istringstream object
 			while (std::getline(string_str, pos_cl_dev, ' ')) { //go through splitted third argument
 				if (this->openCLMan->add_sel_cl_dev(pos_cl_dev) == false) { //at least one device is not valid OpenCL device, abort...
-					std::cout << "ERROR: Device \"" << pos_cl_dev << "\" is not valid OpenCL device! Usage: \"pprsolver.exe file processor[all | SMP | opencl_device_name]\"" << std::endl;
+					std::cout << "ERROR: Device \"" << pos_cl_dev << "\" is not valid OpenCL device! ";
+					this->print_usage();
 					this->openCLMan->print_avail_cl_devs();
 					return false;
 				}
@@ -81,7 +90,8 @@ bool Initializer::init_via_args()
 	else { //argc > 3, expect more OpenCL devices...
 		for (int i = 2; i < argc; i++) { //check validity for each OpenCL device
 			if (this->openCLMan->add_sel_cl_dev(argv[i]) == false) {
-				std::cout << "ERROR: Device \"" << argv[i] << "\" is not valid OpenCL device! Usage: \"pprsolver.exe file processor[all | SMP | opencl_device_name]\"" << std::endl;
+				std::cout << "ERROR: Device \"" << argv[i] << "\" is not valid OpenCL device! ";
+				this->print_usage();
 				this->openCLMan->print_avail_cl_devs();
 				return false;
 			}
@@ -95,6 +105,142 @@ bool Initializer::init_via_args()
 	return true;
 }
 
+/*
+Goes through arguments given by user and extracts optional "--option" arguments into run_settings structure. Positional arguments (file + computing type) are kept in the original order and argc / argv are updated to contain only these.
+return = true if all options are known, else false
+*/
+bool Initializer::parse_opt_args()
+{
+	this->pos_argv.clear();
+	for (int i = 0; i < this->argc; i++) {
+		if (i == 0 || strncmp(this->argv[i], "--", 2) != 0) { //positional argument, keep
+			this->pos_argv.push_back(this->argv[i]);
+		}
+		else if (strcmp(this->argv[i], "--mmap") == 0) { //read input file using memory mapping
+			this->run_settings.mmap_read = true;
+		}
+		else if (strcmp(this->argv[i], "--direct") == 0) { //read input file using direct I/O
+			this->run_settings.direct_read = true;
+		}
+		else if (strcmp(this->argv[i], "--single-pass") == 0) { //read file only once
+			this->run_settings.single_pass = true;
+		}
+		else if (strcmp(this->argv[i], "--index") == 0) { //use sidecar block index
+			this->run_settings.block_index = true;
+		}
+		else if (strncmp(this->argv[i], "--chunk-size=", 13) == 0) { //count of doubles read at once
+			long long opt_num;
+			if (this->parse_opt_num(this->argv[i] + 13, 1, INT_MAX / sizeof(double), &opt_num) == false) {
+				return false;
+			}
+			this->run_settings.chunk_size = static_cast<size_t>(opt_num);
+		}
+		else if (strncmp(this->argv[i], "--queue-depth=", 14) == 0) { //count of chunks read ahead
+			long long opt_num;
+			if (this->parse_opt_num(this->argv[i] + 14, 0, 1024, &opt_num) == false) {
+				return false;
+			}
+			this->run_settings.queue_depth = static_cast<int>(opt_num);
+		}
+		else if (strncmp(this->argv[i], "--read-threads=", 15) == 0) { //count of threads reading file concurrently
+			long long opt_num;
+			if (this->parse_opt_num(this->argv[i] + 15, 1, MAX_READ_THREAD_COUNT, &opt_num) == false) {
+				return false;
+			}
+			this->run_settings.read_threads = static_cast<int>(opt_num);
+		}
+		else if (strncmp(this->argv[i], "--cl-ring-depth=", 16) == 0) { //count of chunks in flight on each OpenCL device
+			long long opt_num;
+			if (this->parse_opt_num(this->argv[i] + 16, 1, MAX_CL_RING_DEPTH, &opt_num) == false) {
+				return false;
+			}
+			this->run_settings.cl_ring_depth = static_cast<int>(opt_num);
+		}
+		else if (strncmp(this->argv[i], "--report=", 9) == 0) { //path to JSON run report
+			if (this->argv[i][9] == '\0') {
+				std::cout << "ERROR: Option --report expects file name. ";
+				this->print_usage();
+				return false;
+			}
+			this->run_settings.report_file = this->argv[i] + 9;
+		}
+		else {
+			std::cout << "ERROR: Unknown option \"" << this->argv[i] << "\". ";
+			this->print_usage();
+			return false;
+		}
+	}
+
+	if (this->pos_argv.size() > 1 && strcmp(this->pos_argv[1], STDIN_FILE_NAME) == 0) { //numbers streamed from standard input, can be read only once
+		this->run_settings.stream_input = true;
+		if (this->run_settings.mmap_read || this->run_settings.direct_read || this->run_settings.block_index) {
+			std::cout << "ERROR: Options --mmap, --direct and --index cannot be used with streamed input. ";
+			this->print_usage();
+			return false;
+		}
+		this->run_settings.single_pass = true; //second read of stream not possible
+		this->run_settings.read_threads = 1; //stream is read sequentially
+	}
+
+	if (this->run_settings.mmap_read && this->run_settings.direct_read) { //mapped file is always read through page cache
+		std::cout << "ERROR: Options --mmap and --direct cannot be combined. ";
+		this->print_usage();
+		return false;
+	}
+
+	size_t align_nums = DIRECT_IO_ALIGNMENT / sizeof(double);
+	if (this->run_settings.direct_read && this->run_settings.chunk_size % align_nums != 0) { //chunks must start on aligned offset to be read without copy
+		this->run_settings.chunk_size = ((this->run_settings.chunk_size + align_nums - 1) / align_nums) * align_nums;
+	}
+
+	this->argc = static_cast<int>(this->pos_argv.size());
+	this->argv = this->pos_argv.data();
+	this->openCLMan->set_input_nums_count(this->run_settings.chunk_size); //OpenCL input buffers must hold whole chunk
+	this->openCLMan->set_ring_depth(this->run_settings.cl_ring_depth);
+	return true;
+}
+
+/*
+Parses numeric value of option (part of argument after "=") and checks whether it lies in allowed range.
+const char* opt_arg = value of option
+long long min_value = minimal allowed value
+long long max_value = maximal allowed value
+long long* opt_num = output, parsed value
+return = true if value is valid number in allowed range, else false
+*/
+bool Initializer::parse_opt_num(const char* opt_arg, long long min_value, long long max_value, long long* opt_num)
+{
+	char* parse_end;
+	long long parsed_num = strtoll(opt_arg, &parse_end, 10);
+	if (parse_end == opt_arg || *parse_end != '\0' || parsed_num < min_value || parsed_num > max_value) {
+		std::cout << "ERROR: Invalid option value \"" << opt_arg << "\", expected number in range " << min_value << " - " << max_value << ". ";
+		this->print_usage();
+		return false;
+	}
+
+	*opt_num = parsed_num;
+	return true;
+}
+
+/*
+Prints usage of the program, including optional arguments.
+*/
+void Initializer::print_usage()
+{
+	std::cout << "Usage: \"pprsolver.exe file processor[all | SMP | opencl_device_name] [options]\"" << std::endl;
+	std::cout << "file: path to file with doubles, or \"" << STDIN_FILE_NAME << "\" to read numbers streamed from standard input (single pass is used)" << std::endl;
+	std::cout << "options:" << std::endl;
+	std::cout << "  --mmap = read input file using memory mapping (no copy of file content)" << std::endl;
+	std::cout << "  --direct = read input file using direct I/O, page cache is bypassed (chunk size is rounded up to multiple of " << DIRECT_IO_ALIGNMENT / sizeof(double) << ")" << std::endl;
+	std::cout << "  --single-pass = read file only once, intervals are derived from adaptive fine histogram (halves I/O, interval counts approximated)" << std::endl;
+	std::cout << "  --index = keep statistics of file blocks in sidecar file (file name + " << BLOCK_INDEX_FILE_SUFFIX << "), repeated runs skip first round / read appended part only" << std::endl;
+	std::cout << "  --chunk-size=N = count of doubles read from file at once (default " << DOUBLE_READ_COUNT_ONCE << ")" << std::endl;
+	std::cout << "  --queue-depth=N = count of chunks read ahead of computation by reader thread, 0 disables reader thread (default " << PREFETCH_QUEUE_DEPTH << ")" << std::endl;
+	std::cout << "  --read-threads=N = count of threads which read different parts of file concurrently, chunks are processed in order of arrival (default " << READ_THREAD_COUNT << ")" << std::endl;
+	std::cout << "  --cl-ring-depth=N = count of chunks in flight on each OpenCL device, upload of next chunk overlaps computation of previous one (default " << CL_RING_DEPTH << ")" << std::endl;
+	std::cout << "  --report=FILE = path to JSON report with wall time + throughput of each stage and work done by each device (default " << RUN_REPORT_FILE_NAME << ")" << std::endl;
+}
+
 /*
 Prints basic information regarding to program initialization. 
 Ie. name of file to be parsed + computing type and eventually OpenCL device on which calculation will be performed.
@@ -102,7 +248,7 @@ Ie. name of file to be parsed + computing type and eventually OpenCL device on w
 void Initializer::print_init_info()
 {
 	std::cout << "***Program init info - START***" << std::endl;
-	std::cout << "file to parse: " << this->input_file_name << std::endl;
+	std::cout << "file to parse: " << (this->run_settings.stream_input ? "standard input (stream)" : this->input_file_name) << std::endl;
 
 	std::cout << "selected computing type: ";
 	switch (this->sel_comp_type) {
@@ -122,6 +268,10 @@ void Initializer::print_init_info()
 	for (int i = 0; i < this->sel_cl_devices.size(); i++) {
 		std::cout << "using OpenCL device \"" << sel_cl_devices[i] << "\"" << std::endl;
 	}
+
+	std::cout << "file read mode: " << (this->run_settings.mmap_read ? "memory mapped" : (this->run_settings.direct_read ? "direct I/O" : "fread")) << ", chunk size: " << this->run_settings.chunk_size << ", queue depth: " << this->run_settings.queue_depth << ", read threads: " << this->run_settings.read_threads << std::endl;
+	std::cout << "validity filter: " << ValidityFilter::get_simd_name() << std::endl;
+	std::cout << "file passes: " << (this->run_settings.single_pass ? "single (adaptive histogram)" : "two") << ", block index: " << (this->run_settings.block_index ? "enabled" : "disabled") << std::endl;
 	std::cout << "***Program init info - END***" << std::endl;
 }
 
@@ -156,3 +306,11 @@ compute_type Initializer::get_sel_comp_type()
 {
 	return this->sel_comp_type;
 }
+
+/*
+Getter for optional settings given by user.
+*/
+run_settings_struct Initializer::get_run_settings()
+{
+	return this->run_settings;
+}
@@ -17,6 +17,12 @@ class Initializer
 		std::string input_file_name; //name of file which is supposed to be parsed
 		compute_type sel_comp_type; //desired computing type defined by user (enum compute_type)
 		std::vector<std::string> sel_cl_devices; //array which contains OpenCL devices on which calculation should be performed - used only if selCompType is OPENCL / ALL
+		std::vector<char*> pos_argv; //arguments given by user without "--option" arguments
+		run_settings_struct run_settings; //optional settings given by "--option" arguments
+
+		bool parse_opt_args(); //extracts "--option" arguments, leaves positional ones
+		bool parse_opt_num(const char* opt_arg, long long min_value, long long max_value, long long* opt_num); //parses numeric value of option
+		void print_usage(); //prints usage of the program
 
 	public:
 		Initializer(int argc, char** argv, OpenCLManager* openCLMan); //constructor takes just reference to given values, instances
@@ -25,5 +31,6 @@ class Initializer
 		bool is_file_available(std::string file_name); //checks if file is readable
 		std::string get_input_file_name(); //name of file specified by user
 		compute_type get_sel_comp_type(); //desired computing type
+		run_settings_struct get_run_settings(); //optional settings given by user
 };
 
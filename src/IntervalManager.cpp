@@ -8,9 +8,9 @@
 Constructor inits array with occurrance counter for each interval - using Sturges rule: k = 1 + 3,32  log(n).
 double min_value_data = minimum value found in dataset (lower boundary of first counter)
 double max_value_data = maximum value found in dataset (upper boundary of last counter)
-long count = count of valid numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
+long long count = count of valid numbers in dataset (std::fpclassify gives FP_NORMAL / FP_ZERO)
 */
-IntervalManager::IntervalManager(double min_value_data, double max_value_data, long count)
+IntervalManager::IntervalManager(double min_value_data, double max_value_data, long long count)
 {
 	//input values
 	this->min_value_data = min_value_data;
@@ -31,7 +31,7 @@ IntervalManager::IntervalManager(double min_value_data, double max_value_data, l
 
 	this->interval_size = (part_int_size_1 - part_int_size_2); //size: (max - min) / available interval count
 
-	this->interval_counter = std::vector<int>(this->interval_count, 0);
+	this->interval_counter = std::vector<long long>(this->interval_count, 0);
 	this->interval_bound_low = std::vector<double>(this->interval_count, 0);
 	this->interval_bound_up = std::vector<double>(this->interval_count, 0);
 
@@ -54,11 +54,11 @@ Merges intervals so that every resulting interval has count >= 5. This requireme
 Algorithm is: go through intervals - if interval with insufficient count found, try to merge it with following ones until count is >= 5.
 */
 void IntervalManager::merge_intervals() {
-	std::vector<int> interval_counter_merge; //interval counter with updated intervals (>= 5 count each)
+	std::vector<long long> interval_counter_merge; //interval counter with updated intervals (>= 5 count each)
 	std::vector<double> interval_bound_low_merge; //updated interval lower boundaries
 	std::vector<double> interval_bound_up_merge; //updated interval upper boundaries
 
-	int interval_count_orig; //count of one interval, original vector
+	long long interval_count_orig; //count of one interval, original vector
 	double interval_bound_low_orig; //lower boundary - one interval
 	double interval_bound_up_orig; //upper boundary - one interval
 
@@ -133,7 +133,7 @@ int IntervalManager::get_interval_count() {
 /*
 Getter for interval_counter vector object.
 */
-std::vector<int> IntervalManager::get_interval_counter() {
+std::vector<long long> IntervalManager::get_interval_counter() {
 	return this->interval_counter;
 }
 
@@ -185,9 +185,9 @@ double IntervalManager::get_last_interval_bound_up()
 
 /*
 Setter for interval counters.
-std::vector<int> interval_counter interval_counter = contains numeric counter of occurrence for each interval
+std::vector<long long> interval_counter = contains numeric counter of occurrence for each interval
 */
-void IntervalManager::set_interval_counter(std::vector<int> interval_counter)
+void IntervalManager::set_interval_counter(std::vector<long long> interval_counter)
 {
 	this->interval_counter = interval_counter;
 }
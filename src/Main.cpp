@@ -5,6 +5,8 @@
 #include "const.h"
 #include "Watchdog.h"
 #include "OpenCLManager.h"
+#include "BlockIndex.h"
+#include "RunReport.h"
 
 /*
 Function main is serves as entrypoint of application. Function expectes >= 3 arguments: program name + path to file + computing type.
@@ -25,34 +27,116 @@ int main(int argc, char** argv)
     initializer->print_init_info();
     
     FileHelper* fileHelper = new FileHelper(initializer->get_input_file_name()); //contains utils for working with file specified by user (reading, obtaining filesize etc.)
+    fileHelper->set_mmap_read(initializer->get_run_settings().mmap_read);
+    fileHelper->set_direct_read(initializer->get_run_settings().direct_read);
+    ChunkReader* chunkReader = new ChunkReader(fileHelper, initializer->get_run_settings().chunk_size, initializer->get_run_settings().queue_depth, initializer->get_run_settings().read_threads); //reads file chunk by chunk, prefetches chunks ahead of computation
     DecisionDist* decisionDist = new DecisionDist();
     Farmer* farmer = new Farmer(initializer->get_sel_comp_type(), openCLMan->get_compute_cl_devices());
 
     Watchdog::get_instance()->start_watchdog(); //start watchdog
-    perf_first_pass(fileHelper, decisionDist, farmer); //perform first pass of algo and print results
-    print_first_pass_info(fileHelper, decisionDist);
+    RunReport::get_instance()->set_info("file", initializer->get_run_settings().stream_input ? std::string("standard input (stream)") : initializer->get_input_file_name());
+    RunReport::get_instance()->set_info("file_passes", initializer->get_run_settings().single_pass ? "single" : "two");
+    IntervalManager* intervalManager;
+    long long count_dataset;
+    if (initializer->get_run_settings().single_pass) { //read file just once, intervals are derived from fine histogram
+        AdaptiveHistogram* adaptiveHistogram = new AdaptiveHistogram(ADAPTIVE_HIST_BIN_COUNT);
+        if (perf_single_pass(chunkReader, fileHelper, decisionDist, adaptiveHistogram) == false) {
+            return abort_run(farmer);
+        }
+        print_first_pass_info(fileHelper, decisionDist);
+
+        count_dataset = decisionDist->get_count();
+        intervalManager = new IntervalManager(decisionDist->get_min_value(), decisionDist->get_max_value(), count_dataset);
+        intervalManager->set_interval_counter(adaptiveHistogram->calc_interval_counter(intervalManager));
+        decisionDist->merge_chunk_moments();
+        decisionDist->calc_std_dev();
+        decisionDist->finalize_avg_std_dev_normalization();
+    }
+    else {
+        BlockIndex* blockIndex = NULL; //statistics of file blocks from previous runs (optional)
+        if (initializer->get_run_settings().block_index) {
+            blockIndex = new BlockIndex(fileHelper, initializer->get_run_settings().chunk_size);
+            blockIndex->load_index();
+        }
 
-    //second pass of algo setup - START
-    double min_value_dataset = decisionDist->get_min_value();
-    double max_value_dataset = decisionDist->get_max_value();
-    long count_dataset = decisionDist->get_count();
-    
-    IntervalManager* intervalManager = new IntervalManager(min_value_dataset, max_value_dataset, count_dataset); //dataset stays the same
-    openCLMan->alloc_add_nums_to_intervals_buffers(intervalManager->get_interval_count());
-    decisionDist->enable_avg_var_normalization(max_value_dataset);
-
-    decisionDist->reset_count();
-    perf_second_pass(fileHelper, intervalManager, decisionDist, farmer);
-    decisionDist->calc_std_dev();
-    decisionDist->finalize_avg_std_dev_normalization();
+        if (blockIndex != NULL && blockIndex->is_complete()) { //file unchanged since previous run, first pass not needed
+            std::cout << "First round of algorithm skipped, results loaded from block index." << std::endl;
+            blockIndex->apply_first_pass(decisionDist);
+        }
+        else {
+            if (blockIndex != NULL) { //indexed blocks are not read again
+                chunkReader->set_first_chunk(blockIndex->get_valid_block_count());
+            }
+            if (perf_first_pass(chunkReader, decisionDist, farmer, blockIndex) == false) { //perform first pass of algo and print results, index is not saved if file was not read whole
+                return abort_run(farmer);
+            }
+            if (blockIndex != NULL) {
+                chunkReader->set_first_chunk(0);
+                blockIndex->apply_first_pass(decisionDist); //results of read blocks + blocks from index
+                blockIndex->save_index();
+            }
+        }
+        print_first_pass_info(fileHelper, decisionDist);
+
+        //second pass of algo setup - START
+        double min_value_dataset = decisionDist->get_min_value();
+        double max_value_dataset = decisionDist->get_max_value();
+        count_dataset = decisionDist->get_count();
+
+        intervalManager = new IntervalManager(min_value_dataset, max_value_dataset, count_dataset); //dataset stays the same
+        decisionDist->enable_avg_var_normalization(max_value_dataset);
+
+        bool calc_avg_var = blockIndex == NULL || !blockIndex->has_moments(); //average + std. dev. known from previous run of the same file
+        decisionDist->reset_count();
+        if (perf_second_pass(chunkReader, intervalManager, decisionDist, farmer, calc_avg_var) == false) {
+            return abort_run(farmer);
+        }
+        if (calc_avg_var) {
+            decisionDist->calc_std_dev();
+            decisionDist->finalize_avg_std_dev_normalization();
+            if (blockIndex != NULL) {
+                blockIndex->set_moments(decisionDist->get_avg(), decisionDist->get_std_dev());
+                blockIndex->save_index();
+            }
+        }
+        else {
+            decisionDist->set_avg_std_dev(blockIndex->get_avg(), blockIndex->get_std_dev());
+        }
+    }
+    RunReport::get_instance()->start_stage("interval merging");
     intervalManager->merge_intervals();
+    RunReport::get_instance()->end_stage("interval merging", 0, intervalManager->get_interval_count());
+    RunReport::get_instance()->set_info("valid_number_count", static_cast<double>(count_dataset));
+    RunReport::get_instance()->set_info("interval_count", intervalManager->get_interval_count());
     print_second_pass_info(intervalManager, decisionDist);
     //second pass of algo setup - END
 
     //perform chi-square goodness of fit calculations
     ChiSquareManager* chiSquareMan = new ChiSquareManager(count_dataset, decisionDist->get_avg(), intervalManager->get_interval_count());
     perform_chi_square_calc(intervalManager, decisionDist, chiSquareMan);
+    farmer->report_throughput();
+    delete farmer; //stops feeder threads of OpenCL devices
     Watchdog::get_instance()->stop_watchdog(); //stop watchdog
+
+    std::string report_file = initializer->get_run_settings().report_file;
+    if (RunReport::get_instance()->write_json(report_file)) {
+        std::cout << "Run report written to " << report_file << std::endl;
+    }
+    else {
+        std::cout << "WARNING: run report could not be written to " << report_file << std::endl;
+    }
+}
+
+/*
+Ends run whose file could not be read completely (read error / file truncated during run). Results would be computed from part of the file only, so none are printed.
+Farmer* farmer = farmer whose workers (feeder threads of OpenCL devices) should be stopped
+return = exit code of program
+*/
+int abort_run(Farmer* farmer) {
+    std::cout << "ERROR: Input file could not be read completely, computation aborted." << std::endl;
+    delete farmer; //stops feeder threads of OpenCL devices
+    Watchdog::get_instance()->stop_watchdog(); //stop watchdog
+    return -1;
 }
 
 /*
@@ -62,74 +146,114 @@ Function reads whole file and determines numeric values which can be acquired in
 - total count of valid numbers in dataset (std::fpclassify(num) returns FP_NORMAL or FP_ZERO)
 - checks if atleast one number in dataset has decimal point
 - checks if atleast one number in dataset is negative
-FileHelper* fileHelper = contains functions regarding to files
+ChunkReader* chunkReader = reads file chunk by chunk (prefetches chunks ahead)
 DecisionDist* decisionDist = functions which help to decide which distribution is closest
 Farmer* farmer = farmer (farmer-worker model) which keeps track of availability of workers, assigns work
+BlockIndex* blockIndex = statistics of each read block are stored here (NULL if block index not used)
+return = true if whole file was read, false if file could not be opened / read
 */
-void perf_first_pass(FileHelper* fileHelper, DecisionDist* decisionDist, Farmer* farmer) {
+bool perf_first_pass(ChunkReader* chunkReader, DecisionDist* decisionDist, Farmer* farmer, BlockIndex* blockIndex) {
     std::cout << "Performing first round of algorithm, please wait..." << std::endl;
-    Watchdog::get_instance()->reset_timer();
-
-    uintmax_t file_size = fileHelper->deter_file_size();
-    uintmax_t cur_file_offset = 0; //current offset in traversed file
-    std::vector<double> valid_nums;
-
-    fileHelper->open_file_read();
-    double first_num = fileHelper->read_part_file(cur_file_offset, 1)[0];
+    Watchdog::get_instance()->reset_timer("first round", 0);
+    RunReport::get_instance()->start_stage("first round");
 
-    farmer->prep_devs_min_max_dec_point_neg_num(first_num);
-    while ((cur_file_offset + DOUBLE_READ_COUNT_ONCE * sizeof(double)) < file_size) { //read file, update offset
-        std::vector<double> file_nums = fileHelper->read_part_file(cur_file_offset, DOUBLE_READ_COUNT_ONCE); //read doubles from file into array
-        Watchdog::get_instance()->reset_timer();
-
-        for (int i = 0; i < DOUBLE_READ_COUNT_ONCE; i++) {
-            if (fileHelper->is_valid_num(file_nums[i])) { //only update if valid number
-                valid_nums.push_back(file_nums[i]);
-            }
-        }
-
-        if (valid_nums.size() > 0) {
-            farmer->assign_min_max_dec_point_neg_num(valid_nums); //check for min, max, dec.point, negative numbers
-            Watchdog::get_instance()->reset_timer();
-            decisionDist->update_count(static_cast<int>(valid_nums.size())); //update count of valid numbers
-            valid_nums.clear();
-        }
-
-        cur_file_offset += DOUBLE_READ_COUNT_ONCE * sizeof(double);
+    farmer->prep_devs_min_max_dec_point_neg_num(blockIndex != NULL); //statistics of each chunk are stored into block index
+    if (chunkReader->start_read() == false) {
+        return false;
     }
 
-    uintmax_t remaining_bytes = file_size - cur_file_offset;
-    if (remaining_bytes > 0) { //check if any unread numbers in file exist
-        std::vector<double> file_nums = fileHelper->read_part_file(cur_file_offset, remaining_bytes / sizeof(double));
-        Watchdog::get_instance()->reset_timer();
-
-        for (int i = 0; i < remaining_bytes / sizeof(double); i++) {
-            if (fileHelper->is_valid_num(file_nums[i])) {
-                valid_nums.push_back(file_nums[i]);
-            }
-        }
+    unsigned long long bytes_done = 0; //progress reported to watchdog
+    num_span_struct file_nums; //view of doubles from file, last chunk can be shorter
+    while (chunkReader->next_chunk(&file_nums)) { //read file chunk by chunk (chunks are prefetched by reader thread)
+        Watchdog::get_instance()->reset_timer("first round", bytes_done);
+        bytes_done += file_nums.size * sizeof(double);
 
-        if (valid_nums.size() > 0) {
-            farmer->assign_min_max_dec_point_neg_num(valid_nums);
-            Watchdog::get_instance()->reset_timer();
-            decisionDist->update_count(static_cast<int>(valid_nums.size())); //update count of valid numbers
-            valid_nums.clear();
+        if (file_nums.size > 0) { //workers skip invalid numbers and count valid ones, no filtering needed
+            farmer->assign_min_max_dec_point_neg_num(file_nums); //check for min, max, dec.point, negative numbers
+            Watchdog::get_instance()->reset_timer("first round", bytes_done);
         }
     }
 
-    fileHelper->close_file_read();
+    if (chunkReader->stop_read() == false) { //read failed, results of pass are incomplete
+        return false;
+    }
 
     //get results from each device, summarize
     double min_value = 0;
     double max_value = 0;
     bool dec_point_num = false;
     bool negative_num = false;
+    long long valid_count = 0;
 
-    farmer->retr_min_max_dec_point_neg_num_res(&min_value, &max_value, &dec_point_num, &negative_num);
+    farmer->retr_min_max_dec_point_neg_num_res(&min_value, &max_value, &dec_point_num, &negative_num, &valid_count);
+    decisionDist->set_count(valid_count); //count of valid numbers
     decisionDist->set_min_value(min_value);
     decisionDist->set_max_value(max_value);
     decisionDist->set_dec_point_num(dec_point_num);
     decisionDist->set_negative_num(negative_num);
+    if (blockIndex != NULL) { //block without valid number is stored as well (count 0)
+        blockIndex->set_read_blocks(farmer->retr_chunk_first_pass_stats());
+    }
+    RunReport::get_instance()->end_stage("first round", bytes_done, bytes_done / sizeof(double));
+    return true;
+}
+
+/*
+Function reads whole file just once and performs actions of both rounds of algorithm during the read:
+- determines min + max, count of valid numbers, presence of decimal point / negative numbers (as first round) - one fused sweep of each chunk on host, its min + max define range for histogram and invalid numbers are filtered only if sweep found some
+- calculates dataset average + standard deviation (as second round), dataset max is not known yet => moments are not normalized
+- adds numbers into fine histogram, whose range grows when number outside of it is found; intervals are derived from the histogram after the read
+ChunkReader* chunkReader = reads file chunk by chunk (prefetches chunks ahead)
+FileHelper* fileHelper = contains functions regarding to files
+DecisionDist* decisionDist = functions which help to decide which distribution is closest
+AdaptiveHistogram* adaptiveHistogram = fine histogram into which numbers are sorted
+return = true if whole file was read, false if file could not be opened / read
+*/
+bool perf_single_pass(ChunkReader* chunkReader, FileHelper* fileHelper, DecisionDist* decisionDist, AdaptiveHistogram* adaptiveHistogram) {
+    std::cout << "Performing both rounds of algorithm during single read, please wait..." << std::endl;
+    Watchdog::get_instance()->reset_timer("single pass", 0);
+    RunReport::get_instance()->start_stage("single pass");
+
+    std::vector<double> valid_nums; //used only if chunk contains invalid numbers
+    valid_nums.reserve(chunkReader->get_chunk_size());
+    block_stats_struct file_stats; //first round statistics of all chunks read so far
+
+    if (chunkReader->start_read() == false) {
+        return false;
+    }
+
+    unsigned long long bytes_done = 0; //progress reported to watchdog
+    num_span_struct file_nums; //view of doubles from file, last chunk can be shorter
+    while (chunkReader->next_chunk(&file_nums)) {
+        Watchdog::get_instance()->reset_timer("single pass", bytes_done);
+        bytes_done += file_nums.size * sizeof(double);
+
+        block_stats_struct chunk_stats = StatsKernel::calc_chunk_first_pass(file_nums.nums, file_nums.size); //min, max, dec.point, negative numbers + count of valid ones
+        StatsKernel::merge_first_pass(&file_stats, chunk_stats);
+        if (chunk_stats.count == 0) {
+            continue;
+        }
+
+        num_span_struct valid_span = file_nums;
+        if (static_cast<size_t>(chunk_stats.count) != file_nums.size) { //only valid numbers are processed, copy made only if chunk contains invalid one
+            valid_span = fileHelper->filter_valid_nums(file_nums, &valid_nums);
+        }
+        decisionDist->update_avg_var_chunk(valid_span); //partial moments of chunk, merged after whole file is read
+        adaptiveHistogram->add_nums(valid_span, chunk_stats.min_value, chunk_stats.max_value);
+        Watchdog::get_instance()->reset_timer("single pass", bytes_done);
+    }
+
+    if (chunkReader->stop_read() == false) { //read failed, results of pass are incomplete
+        return false;
+    }
+
+    decisionDist->set_count(file_stats.count); //count of valid numbers
+    decisionDist->set_min_value(file_stats.count > 0 ? file_stats.min_value : 0);
+    decisionDist->set_max_value(file_stats.count > 0 ? file_stats.max_value : 0);
+    decisionDist->set_dec_point_num(file_stats.dec_point_num);
+    decisionDist->set_negative_num(file_stats.negative_num);
+    RunReport::get_instance()->end_stage("single pass", bytes_done, bytes_done / sizeof(double));
+    return true;
 }
 
 /*
@@ -170,67 +294,47 @@ void print_second_pass_info(IntervalManager* intervalManager, DecisionDist* deci
 Function reads whole file and performs actions which are defined for second round of algorithm, namely:
 - adds numbers present in file into respective intervals
 - calculates dataset average + standard deviation
-FileHelper* fileHelper = contains functions regarding to files
+ChunkReader* chunkReader = reads file chunk by chunk (prefetches chunks ahead)
 IntervalManager* intervalManager = functions which are responsible for managing content of intervals into which are numbers sorted
 DecisionDist* decisionDist = functions which help to decide which distribution is closest
 Farmer* farmer = farmer (farmer-worker model) which keeps track of availability of workers, assigns work
+bool calc_avg_var = true if average + std. dev. should be calculated, false if they are known (block index)
+return = true if whole file was read, false if file could not be opened / read
 */
-void perf_second_pass(FileHelper* fileHelper, IntervalManager* intervalManager, DecisionDist* decisionDist, Farmer* farmer) {
+bool perf_second_pass(ChunkReader* chunkReader, IntervalManager* intervalManager, DecisionDist* decisionDist, Farmer* farmer, bool calc_avg_var) {
     std::cout << "Performing second round of algorithm, please wait..." << std::endl;
-    Watchdog::get_instance()->reset_timer();
-
-    uintmax_t file_size = fileHelper->deter_file_size();
-    uintmax_t cur_file_offset = 0; //current offset in traversed file
-    std::vector<double> valid_nums;
-
-    fileHelper->open_file_read();
-
-    farmer->prep_devs_intervals(intervalManager->get_interval_count());
-    while ((cur_file_offset + DOUBLE_READ_COUNT_ONCE * sizeof(double)) < file_size) { //read file, update offset
-        std::vector<double> file_nums = fileHelper->read_part_file(cur_file_offset, DOUBLE_READ_COUNT_ONCE); //read doubles from file into array
-        Watchdog::get_instance()->reset_timer();
-
-        for (int i = 0; i < DOUBLE_READ_COUNT_ONCE; i++) {
-            if (fileHelper->is_valid_num(file_nums[i])) { //only update if valid number
-                decisionDist->update_avg_var(file_nums[i]);
-                valid_nums.push_back(file_nums[i]);
-            }
-        }
+    Watchdog::get_instance()->reset_timer("second round", 0);
+    RunReport::get_instance()->start_stage("second round");
 
-        if (valid_nums.size() > 0) {
-            farmer->assign_add_nums_to_intervals(valid_nums, intervalManager->get_interval_size(), decisionDist->get_min_value(), intervalManager->get_interval_count()); //add numbers into respective intervals
-            Watchdog::get_instance()->reset_timer();
-            valid_nums.clear();
-        }
-
-        cur_file_offset += DOUBLE_READ_COUNT_ONCE * sizeof(double);
+    farmer->prep_devs_intervals(intervalManager->get_interval_count(), calc_avg_var, decisionDist->get_normalize_val()); //moments are calculated by workers together with intervals
+    if (chunkReader->start_read() == false) {
+        return false;
     }
 
-    uintmax_t remaining_bytes = file_size - cur_file_offset;
-    if (remaining_bytes > 0) { //check if any unread numbers in file exist
-        std::vector<double> file_nums = fileHelper->read_part_file(cur_file_offset, remaining_bytes / sizeof(double));
-        Watchdog::get_instance()->reset_timer();
-
-        for (int i = 0; i < remaining_bytes / sizeof(double); i++) {
-            if (fileHelper->is_valid_num(file_nums[i])) { //only update if valid number
-                decisionDist->update_avg_var(file_nums[i]);
-                valid_nums.push_back(file_nums[i]);
-            }
-        }
-
-        if (valid_nums.size() > 0) {
-            farmer->assign_add_nums_to_intervals(valid_nums, intervalManager->get_interval_size(), decisionDist->get_min_value(), intervalManager->get_interval_count()); //add numbers into respective intervals
-            Watchdog::get_instance()->reset_timer();
-            valid_nums.clear();
-        }
+    unsigned long long bytes_done = 0; //progress reported to watchdog
+    num_span_struct file_nums; //view of doubles from file, last chunk can be shorter
+    while (chunkReader->next_chunk(&file_nums)) { //read file chunk by chunk (chunks are prefetched by reader thread)
+        Watchdog::get_instance()->reset_timer("second round", bytes_done);
+        bytes_done += file_nums.size * sizeof(double);
+        farmer->assign_add_nums_to_intervals(file_nums, intervalManager->get_interval_size(), decisionDist->get_min_value(), intervalManager->get_interval_count()); //add numbers into respective intervals + moments of numbers, invalid ones are skipped by workers
+        Watchdog::get_instance()->reset_timer("second round", bytes_done);
+    }
+    if (chunkReader->stop_read() == false) { //read failed, results of pass are incomplete
+        return false;
     }
-    fileHelper->close_file_read();
 
     //get results from each device, summarize
-    std::vector<int> output_intervals(intervalManager->get_interval_count(), 0); //output buffer
+    std::vector<long long> output_intervals(intervalManager->get_interval_count(), 0); //output buffer
 
     farmer->retr_add_nums_to_intervals_res(&output_intervals, intervalManager->get_interval_count());
     intervalManager->set_interval_counter(output_intervals);
+    if (calc_avg_var) {
+        moments_struct moments;
+        farmer->retr_moments_res(&moments);
+        decisionDist->set_moments(moments);
+    }
+    RunReport::get_instance()->end_stage("second round", bytes_done, bytes_done / sizeof(double));
+    return true;
 }
 
 /*
@@ -240,34 +344,46 @@ DecisionDist* decisionDist = functions which help to decide which distribution i
 ChiSquareManager* chiSquareMan = functions for solving chi-square test
 */
 void perform_chi_square_calc(IntervalManager* intervalManager, DecisionDist* decisionDist, ChiSquareManager* chiSquareMan) {
-    Watchdog::get_instance()->reset_timer();
+    Watchdog::get_instance()->reset_timer("chi-square - distribution functions", 0);
+    RunReport::get_instance()->start_stage("chi-square - distribution functions");
     chi_part_res_struct* dist_func_res = chiSquareMan->calc_distrib_func(intervalManager, decisionDist);
     std::cout << "****CALCULATED DISTRIBUTION FUNCTIONS*** START" << std::endl;
     chiSquareMan->print_chi_part_res(dist_func_res);
     std::cout << "****CALCULATED DISTRIBUTION FUNCTIONS*** END" << std::endl;
-    Watchdog::get_instance()->reset_timer();
+    RunReport::get_instance()->end_stage("chi-square - distribution functions", 0, intervalManager->get_interval_count());
+    Watchdog::get_instance()->reset_timer("chi-square - expected probabilities", 0);
+    RunReport::get_instance()->start_stage("chi-square - expected probabilities");
     chi_part_res_struct* exp_prob_res = chiSquareMan->calc_expected_prob_all_valid_dist(dist_func_res);
     std::cout << "****CALCULATED EXPECTED PROBABILITIES*** START" << std::endl;
     chiSquareMan->print_chi_part_res(exp_prob_res);
     std::cout << "****CALCULATED EXPECTED PROBABILITIES*** END" << std::endl;
-    Watchdog::get_instance()->reset_timer();
+    RunReport::get_instance()->end_stage("chi-square - expected probabilities", 0, intervalManager->get_interval_count());
+    Watchdog::get_instance()->reset_timer("chi-square - expected frequencies", 0);
+    RunReport::get_instance()->start_stage("chi-square - expected frequencies");
     chi_part_res_struct* exp_freq_res = chiSquareMan->calc_expected_freq_all_valid_dist(exp_prob_res);
     std::cout << "****CALCULATED EXPECTED FREQUENCIES*** START" << std::endl;
     chiSquareMan->print_chi_part_res(exp_freq_res);
     std::cout << "****CALCULATED EXPECTED FREQUENCIES*** END" << std::endl;
-    Watchdog::get_instance()->reset_timer();
+    RunReport::get_instance()->end_stage("chi-square - expected frequencies", 0, intervalManager->get_interval_count());
+    Watchdog::get_instance()->reset_timer("chi-square - formulas", 0);
+    RunReport::get_instance()->start_stage("chi-square - formulas");
     chi_part_res_struct* chi_formula_res = chiSquareMan->calc_chi_formula_all_valid_dist(intervalManager, exp_freq_res);
     std::cout << "****CALCULATED CHI-SQUARE FORMULAS*** START" << std::endl;
     chiSquareMan->print_chi_part_res(chi_formula_res);
     std::cout << "****CALCULATED CHI-SQUARE FORMULAS*** END" << std::endl;
-    Watchdog::get_instance()->reset_timer();
+    RunReport::get_instance()->end_stage("chi-square - formulas", 0, intervalManager->get_interval_count());
+    Watchdog::get_instance()->reset_timer("chi-square - test criteria", 0);
+    RunReport::get_instance()->start_stage("chi-square - test criteria");
     std::cout << "****CALCULATED CHI-SQUARE TEST CRITERIA*** START" << std::endl;
     chi_crit_res_struct* chi_crit_res = chiSquareMan->calc_chi_test_crit_all_valid_dist(chi_formula_res);
     chiSquareMan->print_chi_crit_res(chi_crit_res);
     std::cout << "****CALCULATED CHI-SQUARE TEST CRITERIA*** END" << std::endl;
-    Watchdog::get_instance()->reset_timer();
+    RunReport::get_instance()->end_stage("chi-square - test criteria", 0, intervalManager->get_interval_count());
+    Watchdog::get_instance()->reset_timer("chi-square - closest distribution", 0);
+    RunReport::get_instance()->start_stage("chi-square - closest distribution");
     std::cout << "****CLOSEST DISTRIBUTION INFO*** START" << std::endl;
     chi_win_res_struct* chi_lowest_res = chiSquareMan->pick_lowest_test_crit(chi_crit_res);
     chiSquareMan->print_chi_win_res(chi_lowest_res);
     std::cout << "****CLOSEST DISTRIBUTION INFO*** END" << std::endl;
+    RunReport::get_instance()->end_stage("chi-square - closest distribution", 0, intervalManager->get_interval_count());
 }
\ No newline at end of file
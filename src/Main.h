@@ -3,13 +3,19 @@
 #include "cl_defines.h"
 #include "DecisionDist.h"
 #include "FileHelper.h"
+#include "ChunkReader.h"
+#include "AdaptiveHistogram.h"
+#include "BlockIndex.h"
 #include "IntervalManager.h"
 #include "ChiSquareManager.h"
 #include "Farmer.h"
+#include "StatsKernel.h"
 #include "Structures.h"
 
-void perf_first_pass(FileHelper* fileHelper, DecisionDist* decisionDist, Farmer* farmer); //performs first pass of algorithm - dataset min / max number + valid nums count + check for negative / decimal point numbers
+bool perf_first_pass(ChunkReader* chunkReader, DecisionDist* decisionDist, Farmer* farmer, BlockIndex* blockIndex); //performs first pass of algorithm - dataset min / max number + valid nums count + check for negative / decimal point numbers
+int abort_run(Farmer* farmer); //stops workers + watchdog when file could not be read completely, returns exit code
 void print_first_pass_info(FileHelper* fileHelper, DecisionDist* decisionDist); //prints info gathered during first pass of algorithm
-void perf_second_pass(FileHelper* fileHelper, IntervalManager* intervalManager, DecisionDist* decisionDist, Farmer* farmer); //performs second part of algo - sorts numbers into intervals, calc avg + std. dev.
+bool perf_second_pass(ChunkReader* chunkReader, IntervalManager* intervalManager, DecisionDist* decisionDist, Farmer* farmer, bool calc_avg_var); //performs second part of algo - sorts numbers into intervals, calc avg + std. dev.
+bool perf_single_pass(ChunkReader* chunkReader, FileHelper* fileHelper, DecisionDist* decisionDist, AdaptiveHistogram* adaptiveHistogram); //performs both passes of algorithm during one read of file - intervals are derived from adaptive histogram
 void print_second_pass_info(IntervalManager* intervalManager, DecisionDist* decisionDist); //prints info gathered during second pass of algorithm
 void perform_chi_square_calc(IntervalManager* intervalManager, DecisionDist* decisionDist, ChiSquareManager* chiSquareMan); //perform calculation using retrieved values
\ No newline at end of file
@@ -2,6 +2,42 @@
 #include "OpenCLManager.h"
 #include "cl_src.h"
 #include <iostream>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <cstdlib>
+#include "FileHelper.h"
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+Constructor sets default count of numbers which can be processed by device at once (one chunk read from file) + default count of input buffers.
+*/
+OpenCLManager::OpenCLManager() {
+	this->input_nums_count = DOUBLE_READ_COUNT_ONCE;
+	this->ring_depth = CL_RING_DEPTH;
+}
+
+/*
+Sets maximal count of numbers which are processed by device at once. Must be called before devices are set up (input buffers are allocated using this count).
+size_t input_nums_count = count of numbers in one chunk
+*/
+void OpenCLManager::set_input_nums_count(size_t input_nums_count) {
+	this->input_nums_count = input_nums_count;
+}
+
+/*
+Sets count of input buffers of each device (chunks which can be in flight at once). Must be called before devices are set up.
+int ring_depth = count of input buffers
+*/
+void OpenCLManager::set_ring_depth(int ring_depth) {
+	this->ring_depth = ring_depth;
+}
 
 /*
 Loads all available OpenCL platforms + devices.
@@ -56,23 +92,203 @@ int OpenCLManager::retr_cl_dev_index(std::string cl_dev_name)
 }
 
 /*
-Builds program specified by program source code for specific OpenCL device.
+Builds program specified by program source code for specific OpenCL device. Binary of program built earlier is loaded from on-disk cache if present, otherwise program is built from source and its binary is stored into cache.
 std::string program_source = source code of the program
 cl::Device& target_device = target device
 cl::Context cl_device_context = context of the device
 */
 cl::Program OpenCLManager::build_program_from_src(const std::string program_source, cl::Device& target_device, cl::Context cl_device_context) {
-	cl::Program cl_program(cl_device_context, program_source);
-	auto err = cl_program.build("-cl-std=CL2.0");
+	uint64_t program_key = this->calc_program_key(program_source, target_device);
+	cl::Program cl_program;
+	if (this->load_program_binary(program_key, target_device, cl_device_context, &cl_program)) {
+		return cl_program;
+	}
+
+	cl_program = cl::Program(cl_device_context, program_source);
+	auto err = cl_program.build(CL_BUILD_OPTIONS);
 
 	if (err != CL_BUILD_SUCCESS) {
+		std::lock_guard<std::mutex> lock_mutex(this->print_mutex);
 		std::cout << "ERROR: Building program for OpenCL device \"" << target_device.getInfo<CL_DEVICE_NAME>() << "\" failed." << std::endl;
 		std::cout << "Log: " << cl_program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(target_device) << std::endl;
 	}
+	else {
+		this->save_program_binary(program_key, cl_program);
+	}
 
 	return cl_program;
 }
 
+/*
+Calculates key of program binary in cache. Binary can be reused only by the same device + driver, built from the same source with the same options.
+std::string& program_source = source code of the program
+cl::Device& target_device = target device
+return = FNV-1a hash of device name, device version, driver version, build options and program source
+*/
+uint64_t OpenCLManager::calc_program_key(const std::string& program_source, cl::Device& target_device) {
+	std::string key_parts[] = { target_device.getInfo<CL_DEVICE_NAME>(), target_device.getInfo<CL_DEVICE_VERSION>(), target_device.getInfo<CL_DRIVER_VERSION>(), CL_BUILD_OPTIONS, program_source };
+
+	uint64_t program_key = FNV_HASH_OFFSET;
+	for (const std::string& key_part : key_parts) {
+		uint64_t part_size = key_part.size(); //size included, so parts cannot be shifted into each other
+		program_key = FileHelper::calc_hash(&part_size, sizeof(part_size), program_key);
+		program_key = FileHelper::calc_hash(key_part.data(), key_part.size(), program_key);
+	}
+	return program_key;
+}
+
+/*
+Returns directory with cached program binaries - CL_BINARY_CACHE_DIR_NAME inside cache directory of the user (%LOCALAPPDATA% on Windows, $XDG_CACHE_HOME or ~/.cache elsewhere).
+Binaries are executed by devices, so directory shared by more users (eg. temporary directory) is not used. On POSIX systems directory is created with mode 0700 and refused if it is not owned by current user / is accessible by others.
+return = path of cache directory, empty if caching is not possible
+*/
+std::string OpenCLManager::get_binary_cache_dir() {
+	std::filesystem::path cache_dir;
+#ifdef _WIN32
+	const char* local_app_data = std::getenv("LOCALAPPDATA");
+	if (local_app_data == NULL || local_app_data[0] == '\0') {
+		return "";
+	}
+	cache_dir = local_app_data;
+#else
+	const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+	const char* home = std::getenv("HOME");
+	if (xdg_cache_home != NULL && xdg_cache_home[0] == '/') { //relative path is ignored (XDG specification)
+		cache_dir = xdg_cache_home;
+	}
+	else if (home != NULL && home[0] == '/') {
+		cache_dir = std::filesystem::path(home) / ".cache";
+	}
+	else {
+		return "";
+	}
+#endif
+
+	std::error_code fs_error;
+	std::filesystem::create_directories(cache_dir, fs_error);
+	cache_dir /= CL_BINARY_CACHE_DIR_NAME;
+#ifdef _WIN32
+	std::filesystem::create_directory(cache_dir, fs_error); //profile directory of the user is not accessible by others
+	if (fs_error) {
+		return "";
+	}
+#else
+	mkdir(cache_dir.c_str(), 0700); //may already exist, checked below
+	struct stat dir_stat;
+	if (lstat(cache_dir.c_str(), &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode) || dir_stat.st_uid != geteuid() || (dir_stat.st_mode & 077) != 0) {
+		return "";
+	}
+#endif
+	return cache_dir.string();
+}
+
+/*
+Returns path of cache file with program binary (in per-user cache directory, see get_binary_cache_dir).
+uint64_t program_key = key of program binary
+return = path of cache file, empty if cache directory is not available
+*/
+std::string OpenCLManager::get_binary_cache_file(uint64_t program_key) {
+	std::filesystem::path cache_dir = this->get_binary_cache_dir();
+	if (cache_dir.empty()) {
+		return "";
+	}
+
+	char file_name[32];
+	snprintf(file_name, sizeof(file_name), "%016llx.bin", static_cast<unsigned long long>(program_key));
+	return (cache_dir / file_name).string();
+}
+
+/*
+Tries to create program from binary stored in cache. Corrupted / incompatible binary is ignored (program is then built from source and cache file is replaced), so is file which is not regular file owned by current user (POSIX).
+uint64_t program_key = key of program binary
+cl::Device& target_device = target device
+cl::Context cl_device_context = context of the device
+cl::Program* cl_program = program created from binary
+return = true if program was created + built from cached binary, else false
+*/
+bool OpenCLManager::load_program_binary(uint64_t program_key, cl::Device& target_device, cl::Context cl_device_context, cl::Program* cl_program) {
+	std::string cache_file_name = this->get_binary_cache_file(program_key);
+	if (cache_file_name.empty()) {
+		return false;
+	}
+#ifdef _WIN32
+	FILE* cache_file = fopen(cache_file_name.c_str(), "rb");
+#else
+	int cache_file_desc = open(cache_file_name.c_str(), O_RDONLY | O_NOFOLLOW);
+	struct stat file_stat;
+	if (cache_file_desc != -1 && (fstat(cache_file_desc, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_uid != geteuid())) { //checked on opened file, cannot be swapped after the check
+		close(cache_file_desc);
+		cache_file_desc = -1;
+	}
+	FILE* cache_file = cache_file_desc == -1 ? NULL : fdopen(cache_file_desc, "rb");
+	if (cache_file == NULL && cache_file_desc != -1) {
+		close(cache_file_desc);
+	}
+#endif
+	if (cache_file == NULL) { //not cached yet
+		return false;
+	}
+
+	char magic[sizeof(CL_BINARY_CACHE_MAGIC)];
+	uint64_t cached_key = 0;
+	uint64_t binary_size = 0;
+	bool header_valid = fread(magic, sizeof(magic), 1, cache_file) == 1 && memcmp(magic, CL_BINARY_CACHE_MAGIC, sizeof(magic)) == 0
+		&& fread(&cached_key, sizeof(cached_key), 1, cache_file) == 1 && cached_key == program_key
+		&& fread(&binary_size, sizeof(binary_size), 1, cache_file) == 1 && binary_size > 0 && binary_size <= CL_BINARY_CACHE_MAX_SIZE;
+
+	cl::Program::Binaries binaries(1);
+	if (header_valid) {
+		binaries[0].resize(static_cast<size_t>(binary_size));
+		header_valid = fread(binaries[0].data(), 1, binaries[0].size(), cache_file) == binaries[0].size();
+	}
+	fclose(cache_file);
+	if (!header_valid) {
+		return false;
+	}
+
+	cl_int program_error = CL_SUCCESS;
+	std::vector<cl_int> binary_status;
+	*cl_program = cl::Program(cl_device_context, { target_device }, binaries, &binary_status, &program_error);
+	if (program_error != CL_SUCCESS || binary_status.empty() || binary_status[0] != CL_SUCCESS) {
+		return false;
+	}
+	return cl_program->build(CL_BUILD_OPTIONS) == CL_BUILD_SUCCESS; //binary still has to be built (linked) for the device
+}
+
+/*
+Stores binary of built program into cache. File is written under temporary name and renamed, so other process never reads partially written binary. Failure to write cache is not an error.
+uint64_t program_key = key of program binary
+cl::Program& cl_program = program built for one device
+*/
+void OpenCLManager::save_program_binary(uint64_t program_key, cl::Program& cl_program) {
+	std::string cache_file_name = this->get_binary_cache_file(program_key);
+	std::vector<std::vector<unsigned char>> binaries = cl_program.getInfo<CL_PROGRAM_BINARIES>();
+	if (cache_file_name.empty() || binaries.empty() || binaries[0].empty()) {
+		return;
+	}
+
+	std::error_code fs_error;
+	std::string tmp_file_name = cache_file_name + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp"; //devices are built by parallel threads
+	FILE* cache_file = fopen(tmp_file_name.c_str(), "wb");
+	if (cache_file == NULL) {
+		return;
+	}
+
+	uint64_t binary_size = binaries[0].size();
+	fwrite(CL_BINARY_CACHE_MAGIC, sizeof(CL_BINARY_CACHE_MAGIC), 1, cache_file);
+	fwrite(&program_key, sizeof(program_key), 1, cache_file);
+	fwrite(&binary_size, sizeof(binary_size), 1, cache_file);
+	bool write_ok = fwrite(binaries[0].data(), 1, binaries[0].size(), cache_file) == binaries[0].size();
+	write_ok = fclose(cache_file) == 0 && write_ok;
+
+	if (write_ok) {
+		std::filesystem::rename(tmp_file_name, cache_file_name, fs_error);
+	}
+	if (!write_ok || fs_error) {
+		std::filesystem::remove(tmp_file_name, fs_error);
+	}
+}
+
 /*
 Creates context for all selected OpenCL devices. Used later when building programs etc.
 */
@@ -93,19 +309,23 @@ void OpenCLManager::setup_dev_contexts()
 }
 
 /*
-Builds all required OpenCL programs for all selected devices on which computing will be performed.
+Builds all required OpenCL programs for all selected devices on which computing will be performed. Each device is built by its own thread (devices are built in parallel), cached binaries are used if available.
 */
 bool OpenCLManager::build_req_cl_programs()
 {
-	cl::Program program;
+	std::vector<std::thread> build_threads;
 
 	std::cout << "OpenCL program build - START" << std::endl;
 	for (int i = 0; i < this->compute_cl_devices.size(); i++) {
 		std::cout << "Building required programs for OpenCL device \"" << this->compute_cl_devices[i].dev.getInfo<CL_DEVICE_NAME>() << "\", please wait..." << std::endl;
-		program = this->build_program_from_src(cl_src_min_max_dec_point_neg_num, this->compute_cl_devices[i].dev, this->compute_cl_devices[i].dev_context);
-		this->compute_cl_devices[i].prog_min_max_dec_point_neg_num = program;
-		program = this->build_program_from_src(cl_src_add_nums_intervals, this->compute_cl_devices[i].dev, this->compute_cl_devices[i].dev_context);
-		this->compute_cl_devices[i].prog_add_nums_intervals = program;
+		build_threads.push_back(std::thread([this, i]() {
+			cl_dev_stuff_struct* cl_dev = &this->compute_cl_devices[i];
+			cl_dev->prog_min_max_dec_point_neg_num = this->build_program_from_src(cl_src_min_max_dec_point_neg_num, cl_dev->dev, cl_dev->dev_context);
+			cl_dev->prog_add_nums_intervals = this->build_program_from_src(cl_src_add_nums_intervals, cl_dev->dev, cl_dev->dev_context);
+		}));
+	}
+	for (size_t i = 0; i < build_threads.size(); i++) {
+		build_threads[i].join();
 	}
 	std::cout << "OpenCL program build - END" << std::endl;
 	return false;
@@ -121,14 +341,32 @@ bool OpenCLManager::setup_cl_kernels()
 	for (int i = 0; i < this->compute_cl_devices.size(); i++) {
 		kernel = cl::Kernel(this->compute_cl_devices[i].prog_min_max_dec_point_neg_num, "min_max_dec_point_neg_num");
 		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num = kernel;
+
+		size_t max_group_size = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(this->compute_cl_devices[i].dev);
+		size_t group_size = 1;
+		while (group_size * 2 <= std::min<size_t>(max_group_size, CL_REDUCTION_GROUP_SIZE)) { //tree reduction in kernel expects power of two
+			group_size *= 2;
+		}
+		this->compute_cl_devices[i].reduction_group_size = group_size;
+
 		kernel = cl::Kernel(this->compute_cl_devices[i].prog_add_nums_intervals, "add_nums_intervals_avg");
 		this->compute_cl_devices[i].ker_add_nums_intervals = kernel;
+		max_group_size = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(this->compute_cl_devices[i].dev);
+		kernel = cl::Kernel(this->compute_cl_devices[i].prog_add_nums_intervals, "add_nums_intervals_local");
+		this->compute_cl_devices[i].ker_add_nums_intervals_local = kernel;
+		max_group_size = std::min<size_t>(max_group_size, kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(this->compute_cl_devices[i].dev));
+		group_size = 1;
+		while (group_size * 2 <= std::min<size_t>(max_group_size, CL_REDUCTION_GROUP_SIZE)) { //moments are reduced in both kernels
+			group_size *= 2;
+		}
+		this->compute_cl_devices[i].intervals_group_size = group_size;
+		this->compute_cl_devices[i].use_local_intervals = false;
 	}
 	return false;
 }
 
 /*
-Prepares command queue for each of computing devices.
+Prepares command queues for each of computing devices. Kernels and uploads of input numbers use separate queues, so upload of next chunk can run while kernel processes previous one.
 */
 bool OpenCLManager::setup_cl_queues() {
 	cl::CommandQueue queue;
@@ -136,6 +374,8 @@ bool OpenCLManager::setup_cl_queues() {
 	for (int i = 0; i < this->compute_cl_devices.size(); i++) {
 		queue = cl::CommandQueue(this->compute_cl_devices[i].dev_context, this->compute_cl_devices[i].dev);
 		this->compute_cl_devices[i].dev_queue = queue;
+		queue = cl::CommandQueue(this->compute_cl_devices[i].dev_context, this->compute_cl_devices[i].dev);
+		this->compute_cl_devices[i].transfer_queue = queue;
 	}
 	return false;
 }
@@ -147,43 +387,45 @@ void OpenCLManager::alloc_cl_buffers() {
 	cl_int buffer_error = 0;
 
 	for (int i = 0; i < this->compute_cl_devices.size(); i++) {
-		this->compute_cl_devices[i].res_min_pos_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(double), NULL, &buffer_error); //result buffer - minimum value in dataset
+		this->compute_cl_devices[i].res_min_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(cl_ulong), NULL, &buffer_error); //result buffer - minimum value in dataset
 		print_err(buffer_error, "ERROR: creation of OpenCL buffer for minimum value (first pass) failed.");
-		this->compute_cl_devices[i].res_max_pos_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(double), NULL, &buffer_error); //result buffer - maximum value in dataset
+		this->compute_cl_devices[i].res_max_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(cl_ulong), NULL, &buffer_error); //result buffer - maximum value in dataset
 		print_err(buffer_error, "ERROR: creation of OpenCL buffer for maximum value (first pass) failed.");
-		this->compute_cl_devices[i].res_min_neg_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(double), NULL, &buffer_error); //result buffer - minimum value in dataset
-		print_err(buffer_error, "ERROR: creation of OpenCL buffer for minimum value (first pass) failed.");
-		this->compute_cl_devices[i].res_max_neg_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(double), NULL, &buffer_error); //result buffer - maximum value in dataset
-		print_err(buffer_error, "ERROR: creation of OpenCL buffer for maximum value (first pass) failed.");
-		this->compute_cl_devices[i].res_dec_point_num_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, sizeof(int), NULL, &buffer_error); //result buffer - decimal point number present
-		print_err(buffer_error, "ERROR: creation of OpenCL buffer for integer (0 / 1) indicating whether decimal point number is present (first pass) failed.");
-		this->compute_cl_devices[i].input_nums_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, DOUBLE_READ_COUNT_ONCE * sizeof(double), NULL, &buffer_error); //input numbers - copy to cl, read only cl
-		print_err(buffer_error, "ERROR: creation of OpenCL buffer for interval input numbers failed.");
-		this->compute_cl_devices[i].output_intervals_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, MAX_OUTPUT_INTERVAL_COUNT * sizeof(int), NULL, &buffer_error); //output, interval counter - copy to cl, read only cl, host read only
-		print_err(buffer_error, "ERROR: creation of OpenCL buffer for interval counters (output) failed.");
-
-		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(0, this->compute_cl_devices[i].res_min_pos_buf);
-		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(1, this->compute_cl_devices[i].res_max_pos_buf);
-		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(2, this->compute_cl_devices[i].res_min_neg_buf);
-		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(3, this->compute_cl_devices[i].res_max_neg_buf);
-		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(4, this->compute_cl_devices[i].res_dec_point_num_buf);
-		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(5, this->compute_cl_devices[i].input_nums_buf);
-
-		this->compute_cl_devices[i].ker_add_nums_intervals.setArg(0, this->compute_cl_devices[i].input_nums_buf);
-		this->compute_cl_devices[i].ker_add_nums_intervals.setArg(2, this->compute_cl_devices[i].output_intervals_buf);
-	}
-}
+		this->compute_cl_devices[i].res_flags_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(cl_int), NULL, &buffer_error); //result buffer - decimal point / negative number present
+		print_err(buffer_error, "ERROR: creation of OpenCL buffer for flags indicating whether decimal point / negative number is present (first pass) failed.");
+		this->compute_cl_devices[i].res_count_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(cl_ulong), NULL, &buffer_error); //result buffer - count of processed numbers
+		print_err(buffer_error, "ERROR: creation of OpenCL buffer for count of numbers (first pass) failed.");
+		this->compute_cl_devices[i].zero_copy = this->compute_cl_devices[i].dev.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() == CL_TRUE; //CPU / integrated device, mapping does not copy
+		this->compute_cl_devices[i].input_nums_capacity = this->input_nums_count;
+		this->compute_cl_devices[i].input_nums_bufs.clear();
+		this->compute_cl_devices[i].pinned_nums_bufs.clear();
+		for (int j = 0; j < this->ring_depth; j++) { //ring of input buffers, one chunk in each
+			this->compute_cl_devices[i].input_nums_bufs.push_back(cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, this->input_nums_count * sizeof(double), NULL, &buffer_error)); //input numbers - filled by host (mapped / copied), read only cl
+			print_err(buffer_error, "ERROR: creation of OpenCL buffer for interval input numbers failed.");
+			if (!this->compute_cl_devices[i].zero_copy) { //numbers are uploaded from pinned memory (DMA, no copy into driver staging buffer)
+				this->compute_cl_devices[i].pinned_nums_bufs.push_back(cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, this->input_nums_count * sizeof(double), NULL, &buffer_error));
+				print_err(buffer_error, "ERROR: creation of pinned host buffer for input numbers failed.");
+			}
+		}
+		this->compute_cl_devices[i].output_intervals_capacity = 0; //interval counters are allocated per job, size is known after first pass (see Farmer::prep_devs_intervals)
+		this->compute_cl_devices[i].moment_partials_buf = cl::Buffer(this->compute_cl_devices[i].dev_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, CL_MOMENT_PARTIAL_COUNT * 3 * sizeof(double), NULL, &buffer_error); //count, mean, M2 of each work-group - kept on device during second pass
+		print_err(buffer_error, "ERROR: creation of OpenCL buffer for partial moments (second pass) failed.");
 
-/*
-Allocates buffer for second round of algorithm (adding numbers into respetive intervals).
-int output_intervals_count = number of intervals (size for output buffer)
-*/
-void OpenCLManager::alloc_add_nums_to_intervals_buffers(int output_intervals_count) {
-	std::vector<int> output_intervals(output_intervals_count, 0); //output buffer
-	cl_int buffer_error = 0;
+		size_t group_size = this->compute_cl_devices[i].reduction_group_size;
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(0, this->compute_cl_devices[i].res_min_buf);
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(1, this->compute_cl_devices[i].res_max_buf);
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(2, this->compute_cl_devices[i].res_flags_buf);
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(3, this->compute_cl_devices[i].res_count_buf);
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(6, cl::Local(group_size * sizeof(cl_ulong))); //local min of work-group
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(7, cl::Local(group_size * sizeof(cl_ulong))); //local max of work-group
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(8, cl::Local(group_size * sizeof(cl_int))); //local flags of work-group
+		this->compute_cl_devices[i].ker_min_max_dec_point_neg_num.setArg(9, cl::Local(group_size * sizeof(cl_uint))); //local count of work-group
 
-	for (int i = 0; i < this->compute_cl_devices.size(); i++) {
-		this->compute_cl_devices[i].ker_add_nums_intervals.setArg(3, output_intervals_count);
+		size_t loc_moments_size = this->compute_cl_devices[i].intervals_group_size * 3 * sizeof(double); //count, mean, M2 of each work-item
+		this->compute_cl_devices[i].ker_add_nums_intervals.setArg(6, this->compute_cl_devices[i].moment_partials_buf);
+		this->compute_cl_devices[i].ker_add_nums_intervals.setArg(9, cl::Local(loc_moments_size));
+		this->compute_cl_devices[i].ker_add_nums_intervals_local.setArg(6, this->compute_cl_devices[i].moment_partials_buf);
+		this->compute_cl_devices[i].ker_add_nums_intervals_local.setArg(9, cl::Local(loc_moments_size));
 	}
 }
 
@@ -7,6 +7,8 @@
 #endif
 #include "Structures.h"
 #include <vector>
+#include <mutex>
+#include <cstdint>
 
 //contains functions regarding to OpenCL devices
 class OpenCLManager {
@@ -15,13 +17,21 @@ class OpenCLManager {
 		std::vector<cl::Device> det_cl_devices; //all OpenCL detected devices
 		std::vector<cl::Device> sel_cl_devices; //list of OpenCL devices on which calculation should be performed
 		std::vector<cl_dev_stuff_struct> compute_cl_devices; //contains struct for each OpenCL device used for computation - contains compiled programs for selected device, context etc. 
+		size_t input_nums_count; //maximal count of numbers processed by device at once (size of input buffer)
+		int ring_depth; //count of input buffers of each device (chunks in flight)
+		std::mutex print_mutex; //guards printing of build errors (devices are built in parallel)
 		//variables - END
 
 		//functions - START
 		std::vector<cl::Platform> retr_cl_platforms(); //gets available OpenCL platforms
 		std::vector<cl::Device> retr_cl_dev_for_platf(cl::Platform cl_platform); //gets available OpenCL devices for specific platform
 		int retr_cl_dev_index(std::string cl_dev_name); //checks whether device name is valid, returns index
-		cl::Program build_program_from_src(const std::string program_source, cl::Device& target_device, cl::Context cl_device_context); //builds CL program from source
+		cl::Program build_program_from_src(const std::string program_source, cl::Device& target_device, cl::Context cl_device_context); //builds CL program from source (or loads cached binary)
+		uint64_t calc_program_key(const std::string& program_source, cl::Device& target_device); //key of program binary in cache
+		std::string get_binary_cache_dir(); //per-user directory with cached program binaries (created if needed)
+		std::string get_binary_cache_file(uint64_t program_key); //path of cache file with program binary
+		bool load_program_binary(uint64_t program_key, cl::Device& target_device, cl::Context cl_device_context, cl::Program* cl_program); //creates program from cached binary
+		void save_program_binary(uint64_t program_key, cl::Program& cl_program); //stores binary of built program into cache
 		void print_err(cl_int cl_err, std::string message); //prints errors related to OpenCL
 		void setup_dev_contexts(); //setups CL devs context
 		bool build_req_cl_programs(); //builds required CL programs for specified devices
@@ -30,8 +40,10 @@ class OpenCLManager {
 		void alloc_cl_buffers(); //allocates required buffers for each CL device
 		//functions - END
 	public:
+		OpenCLManager(); //constructor, sets default size of input buffers
+		void set_input_nums_count(size_t input_nums_count); //sets maximal count of numbers processed by device at once
+		void set_ring_depth(int ring_depth); //sets count of input buffers of each device
 		void scan_cl_devs(); //performs system scan and retrieves available CL devices
-		void alloc_add_nums_to_intervals_buffers(int output_intervals_count); //updates count of expected intervals for each CL dev.
 		bool add_sel_cl_dev(std::string cl_dev_name); //if device name valid, adds to list of computing devices
 		void add_all_cl_dev(); //adds all CL devices available in the system to list of computing devices
 		void setup_added_dev(); //performs bulk setup of CL devices (context, queue, kernel...)
@@ -1,6 +1,7 @@
 #include "cl_defines.h"
 #include "PoissonDistrib.h"
 #include <cmath>
+#include <cfloat>
 #include "const.h"
 #include <iostream>
 
@@ -46,17 +47,124 @@ double calc_fact(int number) {
 }
 
 /*
-Calculates Poisson distribution function and returns result. Basically calculates probability function for every integer number located in interval and sums up all results.
-long lower_boundary = lower boundary of interval for which distrib. func. should be solved
-long upper_boundary = upper boundary of interval which should be solved
+Calculates prefactor lambda^a * e^(-lambda) / gamma(a) of incomplete gamma functions, computed in logarithm (no overflow).
+For large a, gamma(a) is expressed by Stirling series, so large terms a * log(lambda), lambda and log(gamma(a)) cancel analytically instead of in floating point.
+double a = parameter of gamma function (> 0)
 */
-double PoissonDistrib::calc_distrib_func_interval(long lower_boundary, long upper_boundary)
+double PoissonDistrib::calc_gamma_prefactor(double a)
 {
-	double totalSum = 0;
+	if (a < POISSON_STIRLING_MIN) {
+		return exp(a * log(this->lambda) - this->lambda - lgamma(a));
+	}
+
+	double rel_diff = (this->lambda - a) / a;
+	double stirling_err = (1.0 / 12 - (1.0 / 360 - 1.0 / (1260 * a * a)) / (a * a)) / a; //log(gamma(a)) - Stirling formula
+	return exp(a * (log1p(rel_diff) - rel_diff) + 0.5 * log(a / (2 * PI)) - stirling_err);
+}
+
+/*
+Calculates regularized lower incomplete gamma function P(a, lambda) using its series. Series converges fast for lambda < a + 1.
+double a = parameter of gamma function (> 0)
+*/
+double PoissonDistrib::calc_gamma_series(double a)
+{
+	double term = 1 / a;
+	double sum = term;
+	for (int n = 1; n < POISSON_GAMMA_MAX_ITER; n++) {
+		term *= this->lambda / (a + n);
+		sum += term;
+		if (term < sum * POISSON_GAMMA_EPS) {
+			break;
+		}
+	}
+
+	return sum * calc_gamma_prefactor(a);
+}
+
+/*
+Calculates regularized upper incomplete gamma function Q(a, lambda) using its continued fraction (modified Lentz method). Continued fraction converges fast for lambda >= a + 1.
+double a = parameter of gamma function (> 0)
+*/
+double PoissonDistrib::calc_gamma_cont_frac(double a)
+{
+	double b = this->lambda + 1 - a;
+	double c = 1 / DBL_MIN;
+	double d = 1 / b;
+	double h = d;
+	for (int n = 1; n < POISSON_GAMMA_MAX_ITER; n++) {
+		double an = -n * (n - a);
+		b += 2;
+		d = an * d + b;
+		if (fabs(d) < DBL_MIN) {
+			d = DBL_MIN;
+		}
+		c = b + an / c;
+		if (fabs(c) < DBL_MIN) {
+			c = DBL_MIN;
+		}
+		d = 1 / d;
+		double delta = d * c;
+		h *= delta;
+		if (fabs(delta - 1) < POISSON_GAMMA_EPS) {
+			break;
+		}
+	}
+
+	return h * calc_gamma_prefactor(a);
+}
+
+/*
+Calculates probability that Poisson variable is >= k (regularized lower incomplete gamma P(k, lambda)) and its complement (< k, ie. distribution function in k - 1).
+Only the function which converges fast is evaluated, the other one is its complement - the smaller one of them is always precise.
+long long k = integer number
+double* res_lower = P(X >= k)
+double* res_upper = P(X < k)
+*/
+void PoissonDistrib::calc_reg_gamma(long long k, double* res_lower, double* res_upper)
+{
+	if (k <= 0) { //Poisson variable is never negative
+		*res_lower = 1;
+		*res_upper = 0;
+	}
+	else if (this->lambda < k + 1) {
+		*res_lower = calc_gamma_series(static_cast<double>(k));
+		*res_upper = 1 - *res_lower;
+	}
+	else {
+		*res_upper = calc_gamma_cont_frac(static_cast<double>(k));
+		*res_lower = 1 - *res_upper;
+	}
+}
 
-	for (int currentNum = lower_boundary; currentNum <= upper_boundary; currentNum++) {
-		totalSum += calc_prob_func_concrete_num(currentNum);
+/*
+Calculates probability that Poisson variable is in between given integer boundaries (inclusive) and returns result.
+Probability is calculated from incomplete gamma function in both boundaries (P(X <= k) = Q(k + 1, lambda)), so cost does not depend on count of integers in interval.
+Difference is taken from the tail in which interval is located (values close to 0, no cancellation of values close to 1).
+long long lower_boundary = lower boundary of interval for which distrib. func. should be solved
+long long upper_boundary = upper boundary of interval which should be solved
+*/
+double PoissonDistrib::calc_distrib_func_interval(long long lower_boundary, long long upper_boundary)
+{
+	if (upper_boundary < lower_boundary) {
+		return 0;
 	}
+	if (this->lambda <= 0) { //all numbers are 0
+		return lower_boundary <= 0 && upper_boundary >= 0 ? 1 : 0;
+	}
+
+	double lower_ge; //P(X >= lower_boundary)
+	double lower_lt; //P(X < lower_boundary)
+	double upper_ge; //P(X >= upper_boundary + 1)
+	double upper_lt; //P(X <= upper_boundary)
+	calc_reg_gamma(lower_boundary, &lower_ge, &lower_lt);
+	calc_reg_gamma(upper_boundary + 1, &upper_ge, &upper_lt);
 
-	return totalSum;
+	double prob;
+	if (lower_boundary > this->lambda) { //right tail
+		prob = lower_ge - upper_ge;
+	}
+	else { //left tail / center
+		prob = upper_lt - lower_lt;
+	}
+	return prob > 0 ? prob : 0;
 }
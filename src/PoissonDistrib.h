@@ -7,9 +7,14 @@ class PoissonDistrib
 		double lambda; //average dataset value
 		//constructor variables - END
 
+		double calc_gamma_prefactor(double a); //lambda^a * e^(-lambda) / gamma(a), common for both incomplete gamma functions
+		double calc_gamma_series(double a); //regularized lower incomplete gamma P(a, lambda) - series
+		double calc_gamma_cont_frac(double a); //regularized upper incomplete gamma Q(a, lambda) - continued fraction
+		void calc_reg_gamma(long long k, double* res_lower, double* res_upper); //P(X >= k) + P(X < k) of Poisson variable using incomplete gamma function
+
 	public:
 		PoissonDistrib(double lambda); //expects dataset avg
 		double calc_prob_func_concrete_num(double x); //calculates probability function for given number
-		double calc_distrib_func_interval(long lower_boundary, long upper_boundary); //calcs distribution function for every numbers in between interval boundaries
+		double calc_distrib_func_interval(long long lower_boundary, long long upper_boundary); //calcs probability of integer numbers in between interval boundaries (closed form, cost does not depend on interval size)
 };
 
@@ -0,0 +1,211 @@
+#include "cl_defines.h"
+#include "RunReport.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+/*
+Acts as a singleton, one report for whole run.
+*/
+RunReport* RunReport::get_instance()
+{
+	static RunReport* instance = new RunReport();
+	return instance;
+}
+
+/*
+Private constructor, remembers start of run (total wall time in report).
+*/
+RunReport::RunReport()
+{
+	this->run_start_time = std::chrono::steady_clock::now();
+}
+
+/*
+Finds stage with given name, new stage is appended if not present. Mutex must be held by caller.
+const std::string& name = name of stage
+*/
+stage_stats_struct* RunReport::find_stage(const std::string& name)
+{
+	for (size_t i = 0; i < this->stages.size(); i++) {
+		if (this->stages[i].name == name) {
+			return &this->stages[i];
+		}
+	}
+	stage_stats_struct stage;
+	stage.name = name;
+	this->stages.push_back(stage);
+	return &this->stages.back();
+}
+
+/*
+Finds device with given key, new device is appended if not present. Mutex must be held by caller.
+const std::string& key = SMP / name of OpenCL device + its index (unique for each device)
+const std::string& name = SMP / name of OpenCL device (used for new device)
+*/
+device_stats_struct* RunReport::find_device(const std::string& key, const std::string& name)
+{
+	for (size_t i = 0; i < this->devices.size(); i++) {
+		if (this->devices[i].key == key) {
+			return &this->devices[i];
+		}
+	}
+	device_stats_struct device;
+	device.key = key;
+	device.name = name;
+	this->devices.push_back(device);
+	return &this->devices.back();
+}
+
+/*
+Starts measuring wall time of stage. Stage can be started more times, wall times are summed.
+const std::string& name = name of stage
+*/
+void RunReport::start_stage(const std::string& name)
+{
+	std::unique_lock<std::mutex> uniq_mutex(this->report_mutex);
+	find_stage(name)->start_time = std::chrono::steady_clock::now();
+}
+
+/*
+Stops measuring wall time of stage and adds bytes + numbers processed by it.
+const std::string& name = name of stage (started by start_stage)
+unsigned long long bytes = bytes of file processed in stage
+long long elements = count of numbers / intervals processed in stage
+*/
+void RunReport::end_stage(const std::string& name, unsigned long long bytes, long long elements)
+{
+	std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> uniq_mutex(this->report_mutex);
+	stage_stats_struct* stage = find_stage(name);
+	stage->wall_secs += std::chrono::duration<double>(end_time - stage->start_time).count();
+	stage->bytes += bytes;
+	stage->elements += elements;
+}
+
+/*
+Counts chunk (part of chunk split by scheduler) assigned to device.
+const std::string& device_key = SMP / name of OpenCL device + its index
+const std::string& device_name = SMP / name of OpenCL device
+size_t num_count = count of numbers in chunk
+*/
+void RunReport::add_device_chunk(const std::string& device_key, const std::string& device_name, size_t num_count)
+{
+	std::unique_lock<std::mutex> uniq_mutex(this->report_mutex);
+	device_stats_struct* device = find_device(device_key, device_name);
+	device->chunk_count++;
+	device->num_count += static_cast<long long>(num_count);
+}
+
+/*
+Sets smoothed throughput of device measured by scheduler.
+const std::string& device_key = SMP / name of OpenCL device + its index
+const std::string& device_name = SMP / name of OpenCL device
+double throughput = count of numbers processed per second (0 = not measured)
+*/
+void RunReport::set_device_throughput(const std::string& device_key, const std::string& device_name, double throughput)
+{
+	std::unique_lock<std::mutex> uniq_mutex(this->report_mutex);
+	find_device(device_key, device_name)->throughput = throughput;
+}
+
+/*
+Sets general info of run (text value), value with the same key is replaced.
+*/
+void RunReport::set_info(const std::string& key, const std::string& value)
+{
+	std::unique_lock<std::mutex> uniq_mutex(this->report_mutex);
+	for (size_t i = 0; i < this->run_info.size(); i++) {
+		if (this->run_info[i].first == key) {
+			this->run_info[i].second = escape_json(value);
+			return;
+		}
+	}
+	this->run_info.push_back(std::make_pair(key, escape_json(value)));
+}
+
+/*
+Sets general info of run (numeric value), value with the same key is replaced.
+*/
+void RunReport::set_info(const std::string& key, double value)
+{
+	std::ostringstream value_stream;
+	value_stream << std::setprecision(17) << value;
+
+	std::unique_lock<std::mutex> uniq_mutex(this->report_mutex);
+	for (size_t i = 0; i < this->run_info.size(); i++) {
+		if (this->run_info[i].first == key) {
+			this->run_info[i].second = value_stream.str();
+			return;
+		}
+	}
+	this->run_info.push_back(std::make_pair(key, value_stream.str()));
+}
+
+/*
+Encodes text as JSON string (including quotes), control characters are escaped.
+const std::string& text = text to encode
+*/
+std::string RunReport::escape_json(const std::string& text)
+{
+	std::ostringstream escaped;
+	escaped << '"';
+	for (size_t i = 0; i < text.size(); i++) {
+		unsigned char ch = static_cast<unsigned char>(text[i]);
+		if (ch == '"' || ch == '\\') {
+			escaped << '\\' << text[i];
+		}
+		else if (ch < 0x20) {
+			escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(ch) << std::dec;
+		}
+		else {
+			escaped << text[i];
+		}
+	}
+	escaped << '"';
+	return escaped.str();
+}
+
+/*
+Writes report into file in JSON format - general info of run, stages (wall time, bytes, numbers, throughput) and devices (chunks, numbers, throughput).
+const std::string& file_name = path to report file
+return = true if report was written, else false
+*/
+bool RunReport::write_json(const std::string& file_name)
+{
+	double total_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->run_start_time).count();
+	std::unique_lock<std::mutex> uniq_mutex(this->report_mutex);
+
+	std::ofstream report_file(file_name, std::ios::out | std::ios::trunc);
+	if (!report_file.is_open()) {
+		return false;
+	}
+	report_file << std::setprecision(9);
+
+	report_file << "{" << std::endl;
+	report_file << "  \"run\": {" << std::endl;
+	for (size_t i = 0; i < this->run_info.size(); i++) {
+		report_file << "    " << escape_json(this->run_info[i].first) << ": " << this->run_info[i].second << "," << std::endl;
+	}
+	report_file << "    \"total_wall_secs\": " << total_secs << std::endl;
+	report_file << "  }," << std::endl;
+
+	report_file << "  \"stages\": [" << std::endl;
+	for (size_t i = 0; i < this->stages.size(); i++) {
+		const stage_stats_struct& stage = this->stages[i];
+		double secs = stage.wall_secs > 0 ? stage.wall_secs : 0;
+		report_file << "    { \"name\": " << escape_json(stage.name) << ", \"wall_secs\": " << secs << ", \"bytes\": " << stage.bytes << ", \"elements\": " << stage.elements;
+		report_file << ", \"bytes_per_sec\": " << (secs > 0 ? stage.bytes / secs : 0) << ", \"elements_per_sec\": " << (secs > 0 ? stage.elements / secs : 0) << " }" << (i + 1 < this->stages.size() ? "," : "") << std::endl;
+	}
+	report_file << "  ]," << std::endl;
+
+	report_file << "  \"devices\": [" << std::endl;
+	for (size_t i = 0; i < this->devices.size(); i++) {
+		const device_stats_struct& device = this->devices[i];
+		report_file << "    { \"id\": " << escape_json(device.key) << ", \"name\": " << escape_json(device.name) << ", \"chunks\": " << device.chunk_count << ", \"numbers\": " << device.num_count << ", \"throughput_nums_per_sec\": " << device.throughput << " }" << (i + 1 < this->devices.size() ? "," : "") << std::endl;
+	}
+	report_file << "  ]" << std::endl;
+	report_file << "}" << std::endl;
+
+	return report_file.good();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include "Structures.h"
+
+//lightweight instrumentation - collects wall time, bytes and counts of numbers of each stage of computation + work done by each device, written as JSON report at the end of run
+class RunReport
+{
+	private:
+		std::mutex report_mutex; //stages / devices can be updated from more threads
+		std::chrono::steady_clock::time_point run_start_time; //time when instance was created (start of run)
+		std::vector<stage_stats_struct> stages; //stages in order in which they were started first
+		std::vector<device_stats_struct> devices; //workers in order in which they got first work
+		std::vector<std::pair<std::string, std::string>> run_info; //general info of run, values are already JSON encoded
+		RunReport(); //private constructor, avoid more instances
+		stage_stats_struct* find_stage(const std::string& name); //finds stage with given name, creates it if not present
+		device_stats_struct* find_device(const std::string& key, const std::string& name); //finds device with given key, creates it if not present
+		static std::string escape_json(const std::string& text); //encodes text as JSON string
+
+	public:
+		static RunReport* get_instance(); //gets singleton instance
+		void start_stage(const std::string& name); //starts measuring wall time of stage
+		void end_stage(const std::string& name, unsigned long long bytes, long long elements); //stops measuring wall time of stage, adds processed bytes + numbers
+		void add_device_chunk(const std::string& device_key, const std::string& device_name, size_t num_count); //chunk (part of chunk) with given count of numbers was assigned to device
+		void set_device_throughput(const std::string& device_key, const std::string& device_name, double throughput); //sets throughput of device measured by scheduler
+		void set_info(const std::string& key, const std::string& value); //sets general info of run (text)
+		void set_info(const std::string& key, double value); //sets general info of run (number)
+		bool write_json(const std::string& file_name); //writes report into file
+};
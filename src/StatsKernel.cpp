@@ -0,0 +1,387 @@
+#include "cl_defines.h"
+#include "StatsKernel.h"
+#include "ValidityFilter.h"
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "const.h"
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_reduce.h"
+#include "tbb/blocked_range.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define STATS_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+const uint64_t STATS_ABS_MASK = 0x7FFFFFFFFFFFFFFFULL; //all bits except sign
+const uint64_t STATS_EXP_MASK = 0x7FF0000000000000ULL; //exponent bits
+const uint64_t STATS_MANT_MASK = 0x000FFFFFFFFFFFFFULL; //mantissa bits
+const uint64_t STATS_SIGN_MASK = 0x8000000000000000ULL; //sign bit
+const int STATS_EXP_BIAS = 1023; //exponent of 1.0
+const int STATS_MANT_BITS = 52; //count of mantissa bits
+
+/*
+Checks whether valid nonzero number has fractional part using its bits (replaces fmod(num, 1) != 0).
+Numbers with |num| < 1 always have fractional part, numbers with exponent >= 52 never. Else mantissa bits below binary point must be checked.
+uint64_t bits = raw representation of valid nonzero double
+return = true if number has fractional part
+*/
+static inline bool has_fraction_bits(uint64_t bits)
+{
+	int exp = static_cast<int>((bits & STATS_EXP_MASK) >> STATS_MANT_BITS) - STATS_EXP_BIAS;
+	if (exp < 0) {
+		return true;
+	}
+	if (exp >= STATS_MANT_BITS) {
+		return false;
+	}
+	return (bits & (STATS_MANT_MASK >> exp)) != 0;
+}
+
+/*
+Calculates statistics of first round of algorithm for given numbers during one sweep: validity of number (std::fpclassify gives FP_NORMAL / FP_ZERO), count of valid numbers, min, max, presence of negative and decimal point number. Invalid numbers are skipped.
+const double* nums = numbers to process (valid and invalid)
+size_t count = count of numbers
+return = statistics of valid numbers
+*/
+block_stats_struct StatsKernel::calc_first_pass(const double* nums, size_t count)
+{
+	switch (ValidityFilter::get_simd_level()) {
+		case SIMD_AVX512:
+			return calc_first_pass_avx512(nums, count);
+		case SIMD_AVX2:
+			return calc_first_pass_avx2(nums, count);
+		default:
+			return calc_first_pass_scalar(nums, count);
+	}
+}
+
+/*
+Merges statistics of another part of numbers into given statistics.
+block_stats_struct* stats = statistics which are updated
+const block_stats_struct& part_stats = statistics of another part
+*/
+void StatsKernel::merge_first_pass(block_stats_struct* stats, const block_stats_struct& part_stats)
+{
+	stats->min_value = std::min(stats->min_value, part_stats.min_value);
+	stats->max_value = std::max(stats->max_value, part_stats.max_value);
+	stats->count += part_stats.count;
+	stats->dec_point_num |= part_stats.dec_point_num;
+	stats->negative_num |= part_stats.negative_num;
+}
+
+/*
+Calculates statistics of first round of algorithm (see calc_first_pass) for larger count of numbers, blocks are processed by more threads and their statistics merged.
+const double* nums = numbers to process (valid and invalid)
+size_t count = count of numbers
+return = statistics of valid numbers
+*/
+block_stats_struct StatsKernel::calc_chunk_first_pass(const double* nums, size_t count)
+{
+	return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, count), block_stats_struct(),
+		[nums](const tbb::blocked_range<size_t>& br, block_stats_struct stats_local) {
+			merge_first_pass(&stats_local, calc_first_pass(nums + br.begin(), br.size()));
+			return stats_local;
+		},
+		[](block_stats_struct stats_1, const block_stats_struct& stats_2) {
+			merge_first_pass(&stats_1, stats_2);
+			return stats_1;
+		});
+}
+
+/*
+Calculates partial moments (count, mean, M2) of given numbers. Numbers are split into blocks of MOMENT_BLOCK_NUMS, moments of blocks are calculated in parallel and merged in order of blocks.
+Result depends only on numbers and block size (not on count of threads / scheduling), so it is the same across runs.
+const double* nums = valid numbers
+size_t count = count of numbers
+double normalize_val = each number is divided by this value before calculation (prevents overflow, see DecisionDist normalization)
+return = moments of numbers
+*/
+moments_struct StatsKernel::calc_moments(const double* nums, size_t count, double normalize_val)
+{
+	size_t block_count = (count + MOMENT_BLOCK_NUMS - 1) / MOMENT_BLOCK_NUMS;
+	std::vector<moments_struct> block_moments(block_count);
+
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, block_count), [&](const tbb::blocked_range<size_t>& br) {
+		for (size_t i = br.begin(); i < br.end(); i++) {
+			size_t block_start = i * MOMENT_BLOCK_NUMS;
+			block_moments[i] = calc_block_moments(nums + block_start, std::min<size_t>(MOMENT_BLOCK_NUMS, count - block_start), normalize_val);
+		}
+	});
+
+	moments_struct moments;
+	for (size_t i = 0; i < block_count; i++) { //fixed order of merging => deterministic result
+		merge_moments(&moments, block_moments[i]);
+	}
+	return moments;
+}
+
+/*
+Merges moments of another part into given moments using Chan's pairwise formula.
+moments_struct* moments = moments which are updated
+const moments_struct& part_moments = moments of another part
+*/
+void StatsKernel::merge_moments(moments_struct* moments, const moments_struct& part_moments)
+{
+	if (part_moments.count == 0) {
+		return;
+	}
+	if (moments->count == 0) {
+		*moments = part_moments;
+		return;
+	}
+
+	double count_1 = static_cast<double>(moments->count);
+	double count_2 = static_cast<double>(part_moments.count);
+	double count_total = count_1 + count_2;
+	double delta = part_moments.mean - moments->mean;
+
+	moments->mean += delta * (count_2 / count_total);
+	moments->m2 += part_moments.m2 + delta * delta * (count_1 * count_2 / count_total);
+	moments->count += part_moments.count;
+}
+
+/*
+Calculates moments of one block. Block is small enough to stay in L1 cache, so two sweeps (sum => mean, squared differences => M2) are cheap and numerically stable.
+*/
+moments_struct StatsKernel::calc_block_moments(const double* nums, size_t count, double normalize_val)
+{
+	if (ValidityFilter::get_simd_level() != SIMD_SCALAR) { //AVX-512 CPUs use AVX2 version (same lane order => same result)
+		return calc_block_moments_avx2(nums, count, normalize_val);
+	}
+	return calc_block_moments_scalar(nums, count, normalize_val);
+}
+
+/*
+Scalar version of calc_block_moments. Sums are kept in 4 lanes (number i goes to lane i % 4) like in AVX2 version, so result is the same for both versions.
+*/
+moments_struct StatsKernel::calc_block_moments_scalar(const double* nums, size_t count, double normalize_val)
+{
+	moments_struct moments;
+	if (count == 0) {
+		return moments;
+	}
+
+	double lane_sum[4] = { 0, 0, 0, 0 };
+	for (size_t i = 0; i < count; i++) {
+		lane_sum[i % 4] += nums[i] / normalize_val;
+	}
+	moments.count = static_cast<long long>(count);
+	moments.mean = ((lane_sum[0] + lane_sum[1]) + (lane_sum[2] + lane_sum[3])) / moments.count;
+
+	double lane_m2[4] = { 0, 0, 0, 0 };
+	for (size_t i = 0; i < count; i++) {
+		double diff = nums[i] / normalize_val - moments.mean;
+		lane_m2[i % 4] += diff * diff;
+	}
+	moments.m2 = (lane_m2[0] + lane_m2[1]) + (lane_m2[2] + lane_m2[3]);
+	return moments;
+}
+
+/*
+Scalar version of calc_first_pass, used when CPU does not support AVX2 and for remaining numbers after vector loop.
+*/
+block_stats_struct StatsKernel::calc_first_pass_scalar(const double* nums, size_t count)
+{
+	block_stats_struct stats;
+	for (size_t i = 0; i < count; i++) {
+		uint64_t bits;
+		memcpy(&bits, &nums[i], sizeof(bits));
+		uint64_t exp_bits = bits & STATS_EXP_MASK;
+		bool nonzero = (bits & STATS_ABS_MASK) != 0;
+		if (exp_bits == STATS_EXP_MASK || (exp_bits == 0 && nonzero)) { //infinity / NaN / subnormal
+			continue;
+		}
+
+		stats.count++;
+		stats.min_value = std::min(stats.min_value, nums[i]);
+		stats.max_value = std::max(stats.max_value, nums[i]);
+		stats.negative_num |= nonzero && (bits & STATS_SIGN_MASK) != 0;
+		stats.dec_point_num |= nonzero && has_fraction_bits(bits);
+	}
+	return stats;
+}
+
+#ifdef STATS_KERNEL_X86
+/*
+AVX2 version of calc_first_pass, processes 4 doubles at once. Invalid numbers are replaced by neutral values for min / max and masked out from flags.
+Fractional part: mantissa is shifted left by (12 + unbiased exponent), so only bits below binary point remain (shift >= 64 gives zero = integer).
+*/
+TARGET_AVX2 block_stats_struct StatsKernel::calc_first_pass_avx2(const double* nums, size_t count)
+{
+	const __m256i abs_mask = _mm256_set1_epi64x(static_cast<long long>(STATS_ABS_MASK));
+	const __m256i exp_mask = _mm256_set1_epi64x(static_cast<long long>(STATS_EXP_MASK));
+	const __m256i mant_mask = _mm256_set1_epi64x(static_cast<long long>(STATS_MANT_MASK));
+	const __m256i exp_one = _mm256_set1_epi64x(STATS_EXP_BIAS); //exponent field of 1.0
+	const __m256i shift_base = _mm256_set1_epi64x(STATS_EXP_BIAS - (64 - STATS_MANT_BITS)); //exponent field - this = shift which removes integer part
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256d max_neutral = _mm256_set1_pd(-DBL_MAX);
+	const __m256d min_neutral = _mm256_set1_pd(DBL_MAX);
+
+	__m256d vec_min = min_neutral;
+	__m256d vec_max = max_neutral;
+	__m256i vec_negative = zero;
+	__m256i vec_fraction = zero;
+	long long valid_count = 0;
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nums + i));
+		__m256i exp_bits = _mm256_and_si256(bits, exp_mask);
+		__m256i zero_num = _mm256_cmpeq_epi64(_mm256_and_si256(bits, abs_mask), zero);
+		__m256i invalid = _mm256_or_si256(_mm256_cmpeq_epi64(exp_bits, exp_mask), _mm256_andnot_si256(zero_num, _mm256_cmpeq_epi64(exp_bits, zero)));
+		__m256i valid_nonzero = _mm256_andnot_si256(_mm256_or_si256(invalid, zero_num), _mm256_set1_epi64x(-1));
+
+		int invalid_mask = _mm256_movemask_pd(_mm256_castsi256_pd(invalid));
+		valid_count += 4 - ((invalid_mask & 1) + ((invalid_mask >> 1) & 1) + ((invalid_mask >> 2) & 1) + ((invalid_mask >> 3) & 1));
+
+		__m256d vec = _mm256_castsi256_pd(bits);
+		__m256d invalid_pd = _mm256_castsi256_pd(invalid);
+		vec_min = _mm256_min_pd(vec_min, _mm256_blendv_pd(vec, min_neutral, invalid_pd));
+		vec_max = _mm256_max_pd(vec_max, _mm256_blendv_pd(vec, max_neutral, invalid_pd));
+
+		vec_negative = _mm256_or_si256(vec_negative, _mm256_and_si256(valid_nonzero, bits)); //sign bit of valid nonzero numbers
+
+		__m256i exp_field = _mm256_srli_epi64(exp_bits, STATS_MANT_BITS);
+		__m256i below_one = _mm256_cmpgt_epi64(exp_one, exp_field);
+		__m256i fraction_bits = _mm256_sllv_epi64(_mm256_and_si256(bits, mant_mask), _mm256_sub_epi64(exp_field, shift_base)); //negative shift (|num| < 1) gives zero, covered by below_one
+		__m256i fraction = _mm256_or_si256(below_one, _mm256_xor_si256(_mm256_cmpeq_epi64(fraction_bits, zero), _mm256_set1_epi64x(-1)));
+		vec_fraction = _mm256_or_si256(vec_fraction, _mm256_and_si256(valid_nonzero, fraction));
+	}
+
+	block_stats_struct stats = calc_first_pass_scalar(nums + i, count - i);
+	double lanes_min[4], lanes_max[4];
+	_mm256_storeu_pd(lanes_min, vec_min);
+	_mm256_storeu_pd(lanes_max, vec_max);
+	for (int j = 0; j < 4; j++) {
+		stats.min_value = std::min(stats.min_value, lanes_min[j]);
+		stats.max_value = std::max(stats.max_value, lanes_max[j]);
+	}
+	stats.count += valid_count;
+	stats.negative_num |= _mm256_movemask_pd(_mm256_castsi256_pd(vec_negative)) != 0;
+	stats.dec_point_num |= _mm256_testz_si256(vec_fraction, vec_fraction) == 0;
+	return stats;
+}
+
+/*
+AVX-512 version of calc_first_pass, processes 8 doubles at once. Mask registers select valid numbers for min / max and flags.
+*/
+TARGET_AVX512 block_stats_struct StatsKernel::calc_first_pass_avx512(const double* nums, size_t count)
+{
+	const __m512i abs_mask = _mm512_set1_epi64(static_cast<long long>(STATS_ABS_MASK));
+	const __m512i exp_mask = _mm512_set1_epi64(static_cast<long long>(STATS_EXP_MASK));
+	const __m512i mant_mask = _mm512_set1_epi64(static_cast<long long>(STATS_MANT_MASK));
+	const __m512i sign_mask = _mm512_set1_epi64(static_cast<long long>(STATS_SIGN_MASK));
+	const __m512i exp_one = _mm512_set1_epi64(STATS_EXP_BIAS);
+	const __m512i shift_base = _mm512_set1_epi64(STATS_EXP_BIAS - (64 - STATS_MANT_BITS));
+	const __m512i zero = _mm512_setzero_si512();
+
+	__m512d vec_min = _mm512_set1_pd(DBL_MAX);
+	__m512d vec_max = _mm512_set1_pd(-DBL_MAX);
+	__mmask8 any_negative = 0;
+	__mmask8 any_fraction = 0;
+	long long valid_count = 0;
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512i bits = _mm512_loadu_si512(nums + i);
+		__m512i exp_bits = _mm512_and_si512(bits, exp_mask);
+		__mmask8 nonzero = _mm512_cmpneq_epi64_mask(_mm512_and_si512(bits, abs_mask), zero);
+		__mmask8 invalid = _mm512_cmpeq_epi64_mask(exp_bits, exp_mask) | (_mm512_cmpeq_epi64_mask(exp_bits, zero) & nonzero);
+		__mmask8 valid = static_cast<__mmask8>(~invalid);
+		__mmask8 valid_nonzero = valid & nonzero;
+
+		int valid_bits = valid;
+		while (valid_bits != 0) { //count of valid numbers
+			valid_bits &= valid_bits - 1;
+			valid_count++;
+		}
+
+		__m512d vec = _mm512_castsi512_pd(bits);
+		vec_min = _mm512_mask_min_pd(vec_min, valid, vec_min, vec);
+		vec_max = _mm512_mask_max_pd(vec_max, valid, vec_max, vec);
+
+		any_negative |= _mm512_mask_test_epi64_mask(valid_nonzero, bits, sign_mask);
+
+		__m512i exp_field = _mm512_srli_epi64(exp_bits, STATS_MANT_BITS);
+		__mmask8 below_one = _mm512_cmplt_epi64_mask(exp_field, exp_one);
+		__m512i fraction_bits = _mm512_sllv_epi64(_mm512_and_si512(bits, mant_mask), _mm512_sub_epi64(exp_field, shift_base));
+		any_fraction |= valid_nonzero & (below_one | _mm512_test_epi64_mask(fraction_bits, fraction_bits));
+	}
+
+	block_stats_struct stats = calc_first_pass_scalar(nums + i, count - i);
+	stats.min_value = std::min(stats.min_value, _mm512_reduce_min_pd(vec_min));
+	stats.max_value = std::max(stats.max_value, _mm512_reduce_max_pd(vec_max));
+	stats.count += valid_count;
+	stats.negative_num |= any_negative != 0;
+	stats.dec_point_num |= any_fraction != 0;
+	return stats;
+}
+
+/*
+AVX2 version of calc_block_moments, 4 doubles at once. Remaining numbers are added to lanes in the same way as in scalar version.
+*/
+TARGET_AVX2 moments_struct StatsKernel::calc_block_moments_avx2(const double* nums, size_t count, double normalize_val)
+{
+	moments_struct moments;
+	if (count == 0) {
+		return moments;
+	}
+
+	const __m256d vec_normalize = _mm256_set1_pd(normalize_val);
+	size_t vec_count = count - count % 4;
+	double lane_sum[4];
+	__m256d vec_sum = _mm256_setzero_pd();
+	for (size_t i = 0; i < vec_count; i += 4) {
+		vec_sum = _mm256_add_pd(vec_sum, _mm256_div_pd(_mm256_loadu_pd(nums + i), vec_normalize));
+	}
+	_mm256_storeu_pd(lane_sum, vec_sum);
+	for (size_t i = vec_count; i < count; i++) {
+		lane_sum[i % 4] += nums[i] / normalize_val;
+	}
+	moments.count = static_cast<long long>(count);
+	moments.mean = ((lane_sum[0] + lane_sum[1]) + (lane_sum[2] + lane_sum[3])) / moments.count;
+
+	const __m256d vec_mean = _mm256_set1_pd(moments.mean);
+	double lane_m2[4];
+	__m256d vec_m2 = _mm256_setzero_pd();
+	for (size_t i = 0; i < vec_count; i += 4) {
+		__m256d diff = _mm256_sub_pd(_mm256_div_pd(_mm256_loadu_pd(nums + i), vec_normalize), vec_mean);
+		vec_m2 = _mm256_add_pd(vec_m2, _mm256_mul_pd(diff, diff)); //no FMA, same rounding as scalar version
+	}
+	_mm256_storeu_pd(lane_m2, vec_m2);
+	for (size_t i = vec_count; i < count; i++) {
+		double diff = nums[i] / normalize_val - moments.mean;
+		lane_m2[i % 4] += diff * diff;
+	}
+	moments.m2 = (lane_m2[0] + lane_m2[1]) + (lane_m2[2] + lane_m2[3]);
+	return moments;
+}
+#else
+/*
+Vector versions are not available on this platform, scalar version is used.
+*/
+block_stats_struct StatsKernel::calc_first_pass_avx2(const double* nums, size_t count)
+{
+	return calc_first_pass_scalar(nums, count);
+}
+
+block_stats_struct StatsKernel::calc_first_pass_avx512(const double* nums, size_t count)
+{
+	return calc_first_pass_scalar(nums, count);
+}
+
+moments_struct StatsKernel::calc_block_moments_avx2(const double* nums, size_t count, double normalize_val)
+{
+	return calc_block_moments_scalar(nums, count, normalize_val);
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include "Structures.h"
+
+//fused vector kernels which gather statistics of numbers during one read of each cache line; instruction set is the same as picked by ValidityFilter
+class StatsKernel
+{
+	private:
+		static block_stats_struct calc_first_pass_scalar(const double* nums, size_t count); //scalar version of calc_first_pass
+		static block_stats_struct calc_first_pass_avx2(const double* nums, size_t count); //AVX2 version of calc_first_pass
+		static block_stats_struct calc_first_pass_avx512(const double* nums, size_t count); //AVX-512 version of calc_first_pass
+		static moments_struct calc_block_moments_scalar(const double* nums, size_t count, double normalize_val); //scalar version of calc_block_moments
+		static moments_struct calc_block_moments_avx2(const double* nums, size_t count, double normalize_val); //AVX2 version of calc_block_moments
+		static moments_struct calc_block_moments(const double* nums, size_t count, double normalize_val); //moments of one block (fits into L1 cache)
+
+	public:
+		static block_stats_struct calc_first_pass(const double* nums, size_t count); //validity + count + min + max + negative / decimal point flags in one sweep
+		static block_stats_struct calc_chunk_first_pass(const double* nums, size_t count); //calc_first_pass of blocks in parallel, merged
+		static void merge_first_pass(block_stats_struct* stats, const block_stats_struct& part_stats); //merges statistics of another part into given statistics
+		static moments_struct calc_moments(const double* nums, size_t count, double normalize_val); //count, mean, M2 of numbers - blocks in parallel, merged in fixed order
+		static void merge_moments(moments_struct* moments, const moments_struct& part_moments); //merges moments of another part (Chan's formula)
+};
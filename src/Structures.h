@@ -2,6 +2,10 @@
 #include<vector>
 #include<future>
 #include<atomic>
+#include<cfloat>
+#include<string>
+#include<chrono>
+#include "const.h"
 #include <CL/cl.h>
 #if __has_include(<CL/opencl.hpp>)
 # include <CL/opencl.hpp>
@@ -76,15 +80,116 @@ struct chi_win_res_struct {
     double* charasteristic_dist; //values which characterize the specific distribution (could be different for every distribution)
 };
 
+/*
+Read-only view of doubles which are processed as one chunk. Numbers are not owned by the view - they can point directly into memory mapped file or into buffer owned by FileHelper.
+View is valid only until next chunk is requested from the same source.
+*/
+struct num_span_struct {
+    const double* nums = nullptr; //first number of the chunk
+    size_t size = 0; //count of numbers present in the chunk
+    size_t chunk_index = 0; //position of the chunk in file (0 = first chunk)
+};
+
+/*
+Statistics of numbers gathered during first round of algorithm (for one block of input file / part processed by one thread). Stored in sidecar block index.
+*/
+struct block_stats_struct {
+    double min_value = DBL_MAX; //minimum valid number in block
+    double max_value = -DBL_MAX; //maximum valid number in block
+    long long count = 0; //count of valid numbers in block
+    bool dec_point_num = false; //block contains decimal point number
+    bool negative_num = false; //block contains negative number
+};
+
+/*
+Partial moments of part of dataset (block / chunk), parts are merged using Chan's pairwise formula.
+*/
+struct moments_struct {
+    long long count = 0; //count of numbers in part
+    double mean = 0; //average of numbers in part
+    double m2 = 0; //sum of squared differences from mean
+};
+
+/*
+Optional program settings which are given by user using "--option" arguments (in addition to file name + computing type).
+*/
+struct run_settings_struct {
+    bool mmap_read = false; //read input file through memory mapping instead of fread
+    bool direct_read = false; //read input file using direct I/O (bypasses page cache)
+    bool stream_input = false; //numbers are streamed from standard input (pipe), file cannot be seeked / read twice
+    size_t chunk_size = DOUBLE_READ_COUNT_ONCE; //count of doubles read from file at once
+    int queue_depth = PREFETCH_QUEUE_DEPTH; //count of chunks read ahead of computation, 0 = no reader thread
+    int read_threads = READ_THREAD_COUNT; //count of reader threads issuing reads concurrently (used if queue_depth > 0)
+    int cl_ring_depth = CL_RING_DEPTH; //count of input buffers of each OpenCL device (chunks in flight)
+    bool single_pass = false; //read file only once, intervals are derived from adaptive histogram
+    bool block_index = false; //use sidecar index with statistics of file blocks (skips first pass on repeated runs)
+    std::string report_file = RUN_REPORT_FILE_NAME; //file into which JSON run report is written
+};
+
+/*
+State of one input buffer of OpenCL device ring.
+*/
+enum feed_slot_state {
+    SLOT_FREE, //buffer not used yet / kernel which read it waited for
+    SLOT_QUEUED, //buffer filled by producer, task waits in queue of feeder thread
+    SLOT_ENQUEUED //upload + kernel enqueued by feeder thread, kernel event valid
+};
+
+/*
+Result buffer of OpenCL kernel which is read by host right after kernel of one task and reset to its initial value, so results of each chunk are kept separately.
+*/
+struct cl_task_result_struct {
+    cl::Buffer* buf = NULL; //result buffer of device
+    size_t size = 0; //count of bytes read + reset (from start of buffer)
+    void* host_result = NULL; //host memory into which result is read, must stay valid until kernels of device finish
+    const void* init_value = NULL; //initial value written into buffer after read, must stay valid until kernels of device finish
+};
+
+/*
+Results of first round kernel for OpenCL part of one chunk (read after each kernel, used by block index).
+*/
+struct cl_first_pass_res_struct {
+    size_t chunk_index = 0; //index of chunk in file
+    cl_ulong min_key = 0; //min of part (ordered key)
+    cl_ulong max_key = 0; //max of part (ordered key)
+    cl_int flags = 0; //decimal point / negative value found
+    cl_ulong count = 0; //count of valid numbers in part
+};
+
+/*
+Partial moments of work-groups of one OpenCL part of chunk (second round), read after each kernel so that parts can be merged in order of chunks.
+*/
+struct cl_moments_res_struct {
+    size_t chunk_index = 0; //index of chunk in file
+    std::vector<double> partials; //count, mean, M2 of each work-group of the kernel
+};
+
+/*
+Task passed to feeder thread of OpenCL device - numbers in one input buffer of device ring + kernel which should process them.
+*/
+struct cl_feed_task_struct {
+    cl::Kernel* kernel = NULL; //kernel to be enqueued (arguments not related to task already set)
+    size_t ring_index = 0; //input buffer with numbers
+    size_t num_count = 0; //count of numbers in input buffer
+    int input_buf_arg = 0; //index of kernel argument with input buffer
+    int input_size_arg = 0; //index of kernel argument with count of numbers
+    bool interval_args = false; //kernel expects reciprocal of interval size + scaled dataset minimum (arguments 4, 5)
+    double interval_size_recip = 0; //1 / interval size
+    double min_value_scaled = 0; //dataset minimum / interval size
+    size_t global_size = 0; //global range of kernel
+    size_t local_size = 0; //local range of kernel, 0 = chosen by OpenCL implementation
+    std::vector<cl_task_result_struct> results; //result buffers read + reset after kernel (results per chunk), empty = results accumulate on device
+};
+
 /*
 Information regarding to one OpenCL device which is allowed to compute.
 */
 struct cl_dev_stuff_struct {
     cl::Device dev; //OpenCL device info
+    int dev_index; //index of device in list of computing devices (set by Farmer)
     cl::Context dev_context; //OpenCL device context
-    cl::CommandQueue dev_queue; //command queue for the device
-
-    std::shared_future<void> current_task; //task which is currently executed by device
+    cl::CommandQueue dev_queue; //command queue for the device - kernels
+    cl::CommandQueue transfer_queue; //command queue for the device - uploads of input numbers (overlap with kernels)
 
     //programs built for specific OpenCL device
     cl::Program prog_min_max_dec_point_neg_num; //first round of algo
@@ -92,18 +197,49 @@ struct cl_dev_stuff_struct {
 
     //kernels
     cl::Kernel ker_min_max_dec_point_neg_num; //first round of algo
-    cl::Kernel ker_add_nums_intervals; //second round of algo
+    cl::Kernel ker_add_nums_intervals; //second round of algo - global memory intervals
+    cl::Kernel ker_add_nums_intervals_local; //second round of algo - intervals privatized in local memory of work-group
+
+    size_t reduction_group_size; //work-group size used by min_max_dec_point_neg_num (power of two)
+    size_t intervals_group_size; //work-group size used by add_nums_intervals_avg + add_nums_intervals_local (power of two)
+    bool use_local_intervals; //true if intervals fit into local memory of device => add_nums_intervals_local is used
 
     //buffers min_max_dec_point_neg_num + add_nums_to_intervals
-    cl::Buffer input_nums_buf; //min_max_dec_point_neg_num + add_nums_to_intervals
-    cl::Buffer res_min_pos_buf; //minimum value + sign
-    cl::Buffer res_max_pos_buf; //maximum value + sign
-    cl::Buffer res_min_neg_buf; //maximum value - sign
-    cl::Buffer res_max_neg_buf; //maximum value - sign
+    std::vector<cl::Buffer> input_nums_bufs; //ring of input buffers, each holds one chunk (uploads + kernels enqueued by DeviceFeeder)
+    std::vector<cl::Buffer> pinned_nums_bufs; //pinned host staging buffer for each input buffer (devices without unified memory only)
+    size_t input_nums_capacity; //count of numbers which fit into one input buffer
+    bool zero_copy; //device shares memory with host => input buffers are mapped and filled directly, no upload
 
     //buffers - min_max_dec_point_neg_num specific
-    cl::Buffer res_dec_point_num_buf; //decimal point number found by device flag
+    cl::Buffer res_min_buf; //minimum value (as ordered ulong key)
+    cl::Buffer res_max_buf; //maximum value (as ordered ulong key)
+    cl::Buffer res_flags_buf; //decimal point number (bit 0) / negative number (bit 1) found by device
+    cl::Buffer res_count_buf; //count of numbers processed by device
 
     //buffers - add_nums_to_intervals specific
-    cl::Buffer output_intervals_buf; //output intervals into which numbers are sorted
-};
\ No newline at end of file
+    cl::Buffer output_intervals_buf; //output intervals into which numbers are sorted (64-bit counters)
+    int output_intervals_capacity; //count of intervals which fit into output_intervals_buf (reallocated if job needs more)
+    cl::Buffer moment_partials_buf; //count, mean, M2 of numbers processed by each work-group (CL_MOMENT_PARTIAL_COUNT partials), merged by host after whole pass
+};
+
+/*
+Statistics of one stage of computation (pass over file, merging of intervals, step of chi-square test), written into run report.
+*/
+struct stage_stats_struct {
+    std::string name; //name of stage
+    std::chrono::steady_clock::time_point start_time; //time when stage was (last) started
+    double wall_secs = 0; //wall time of stage (summed if stage is started more times)
+    unsigned long long bytes = 0; //bytes of file processed in stage
+    long long elements = 0; //count of numbers / intervals processed in stage
+};
+
+/*
+Work done by one worker (SMP / OpenCL device) during run, written into run report.
+*/
+struct device_stats_struct {
+    std::string key; //SMP / name of OpenCL device + index of device (identical devices are reported separately)
+    std::string name; //SMP / name of OpenCL device
+    long long chunk_count = 0; //count of chunks (parts of chunks) assigned to worker
+    long long num_count = 0; //count of numbers assigned to worker
+    double throughput = 0; //smoothed count of numbers processed per second measured by scheduler (0 = not measured)
+};
@@ -0,0 +1,304 @@
+#include "cl_defines.h"
+#include "ValidityFilter.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VALIDITY_FILTER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+const uint64_t DOUBLE_ABS_MASK = 0x7FFFFFFFFFFFFFFFULL; //all bits except sign
+const uint64_t DOUBLE_EXP_MASK = 0x7FF0000000000000ULL; //exponent bits
+
+simd_level ValidityFilter::sel_simd_level = ValidityFilter::deter_simd_level();
+
+/*
+Checks validity of number using its bits. Exponent with all ones = infinity / NaN, zero exponent with nonzero mantissa = subnormal number - both invalid. Same result as std::fpclassify giving FP_NORMAL / FP_ZERO.
+uint64_t bits = raw representation of double
+return = true if number is valid
+*/
+static inline bool is_valid_bits(uint64_t bits)
+{
+	uint64_t exp_bits = bits & DOUBLE_EXP_MASK;
+	return exp_bits != DOUBLE_EXP_MASK && (exp_bits != 0 || (bits & DOUBLE_ABS_MASK) == 0);
+}
+
+/*
+Determines best instruction set which can be used by filter. AVX-512 / AVX2 are used only if supported by both CPU and OS (saving of vector registers).
+return = instruction set used by filter
+*/
+simd_level ValidityFilter::deter_simd_level()
+{
+#ifdef VALIDITY_FILTER_X86
+#ifdef _MSC_VER
+	int cpu_info[4];
+	__cpuid(cpu_info, 0);
+	int max_leaf = cpu_info[0];
+	__cpuid(cpu_info, 1);
+	bool os_avx = (cpu_info[2] & (1 << 27)) != 0 && (cpu_info[2] & (1 << 28)) != 0; //OSXSAVE + AVX
+	if (!os_avx || max_leaf < 7) {
+		return SIMD_SCALAR;
+	}
+	unsigned long long xcr0 = _xgetbv(0);
+	__cpuidex(cpu_info, 7, 0);
+	if ((cpu_info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6) { //AVX-512F + opmask / ZMM state enabled
+		return SIMD_AVX512;
+	}
+	if ((cpu_info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6) { //AVX2 + YMM state enabled
+		return SIMD_AVX2;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		return SIMD_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return SIMD_AVX2;
+	}
+#endif
+#endif
+	return SIMD_SCALAR;
+}
+
+/*
+Finds first invalid number (std::fpclassify does not give FP_NORMAL / FP_ZERO) in given numbers.
+const double* nums = numbers to check
+size_t count = count of numbers
+return = index of first invalid number, count if all numbers are valid
+*/
+size_t ValidityFilter::find_first_invalid(const double* nums, size_t count)
+{
+	switch (sel_simd_level) {
+		case SIMD_AVX512:
+			return find_first_invalid_avx512(nums, count);
+		case SIMD_AVX2:
+			return find_first_invalid_avx2(nums, count);
+		default:
+			return find_first_invalid_scalar(nums, count);
+	}
+}
+
+/*
+Copies valid numbers (std::fpclassify gives FP_NORMAL / FP_ZERO) into given buffer, order of numbers is kept.
+const double* nums = numbers to filter
+size_t count = count of numbers
+double* valid_nums = output buffer, must have space for count doubles
+return = count of valid numbers written into buffer
+*/
+size_t ValidityFilter::compact_valid(const double* nums, size_t count, double* valid_nums)
+{
+	switch (sel_simd_level) {
+		case SIMD_AVX512:
+			return compact_valid_avx512(nums, count, valid_nums);
+		case SIMD_AVX2:
+			return compact_valid_avx2(nums, count, valid_nums);
+		default:
+			return compact_valid_scalar(nums, count, valid_nums);
+	}
+}
+
+/*
+Getter for sel_simd_level variable.
+*/
+simd_level ValidityFilter::get_simd_level()
+{
+	return sel_simd_level;
+}
+
+/*
+Returns name of instruction set used by filter (for info output).
+*/
+const char* ValidityFilter::get_simd_name()
+{
+	switch (sel_simd_level) {
+		case SIMD_AVX512:
+			return "AVX-512";
+		case SIMD_AVX2:
+			return "AVX2";
+		default:
+			return "scalar";
+	}
+}
+
+/*
+Scalar version of find_first_invalid, used when CPU does not support AVX2 and for remaining numbers after vector loop.
+*/
+size_t ValidityFilter::find_first_invalid_scalar(const double* nums, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		uint64_t bits;
+		memcpy(&bits, &nums[i], sizeof(bits));
+		if (!is_valid_bits(bits)) {
+			return i;
+		}
+	}
+	return count;
+}
+
+/*
+Scalar version of compact_valid, branchless - number is always written, output position moves only if number is valid.
+*/
+size_t ValidityFilter::compact_valid_scalar(const double* nums, size_t count, double* valid_nums)
+{
+	size_t valid_count = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint64_t bits;
+		memcpy(&bits, &nums[i], sizeof(bits));
+		valid_nums[valid_count] = nums[i];
+		valid_count += is_valid_bits(bits) ? 1 : 0;
+	}
+	return valid_count;
+}
+
+#ifdef VALIDITY_FILTER_X86
+/*
+Returns mask of invalid numbers in vector of 4 doubles (bit i set = number i invalid).
+*/
+TARGET_AVX2 static inline int invalid_mask_avx2(const double* nums)
+{
+	const __m256i abs_mask = _mm256_set1_epi64x(static_cast<long long>(DOUBLE_ABS_MASK));
+	const __m256i exp_mask = _mm256_set1_epi64x(static_cast<long long>(DOUBLE_EXP_MASK));
+	const __m256i zero = _mm256_setzero_si256();
+
+	__m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nums));
+	__m256i exp_bits = _mm256_and_si256(bits, exp_mask);
+	__m256i inf_nan = _mm256_cmpeq_epi64(exp_bits, exp_mask); //exponent all ones
+	__m256i zero_exp = _mm256_cmpeq_epi64(exp_bits, zero);
+	__m256i zero_num = _mm256_cmpeq_epi64(_mm256_and_si256(bits, abs_mask), zero);
+	__m256i subnormal = _mm256_andnot_si256(zero_num, zero_exp); //zero exponent, nonzero mantissa
+	return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(inf_nan, subnormal)));
+}
+
+/*
+AVX2 version of find_first_invalid, checks 4 doubles at once.
+*/
+TARGET_AVX2 size_t ValidityFilter::find_first_invalid_avx2(const double* nums, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		int invalid_mask = invalid_mask_avx2(nums + i);
+		if (invalid_mask != 0) {
+			for (int j = 0; j < 4; j++) { //position of lowest set bit
+				if (invalid_mask & (1 << j)) {
+					return i + j;
+				}
+			}
+		}
+	}
+	return i + find_first_invalid_scalar(nums + i, count - i);
+}
+
+/*
+AVX2 version of compact_valid. Valid numbers of each vector are moved to its beginning using permutation picked by mask of valid numbers, whole vector is stored and output position moves by count of valid numbers.
+Store never exceeds count doubles of output, because output position is never greater than input position.
+*/
+TARGET_AVX2 size_t ValidityFilter::compact_valid_avx2(const double* nums, size_t count, double* valid_nums)
+{
+	static const int perm_table[16][8] = { //32bit lane indexes which move valid doubles (set bits of mask) to the front
+		{ 0, 1, 2, 3, 4, 5, 6, 7 }, { 0, 1, 2, 3, 4, 5, 6, 7 }, { 2, 3, 0, 1, 4, 5, 6, 7 }, { 0, 1, 2, 3, 4, 5, 6, 7 },
+		{ 4, 5, 0, 1, 2, 3, 6, 7 }, { 0, 1, 4, 5, 2, 3, 6, 7 }, { 2, 3, 4, 5, 0, 1, 6, 7 }, { 0, 1, 2, 3, 4, 5, 6, 7 },
+		{ 6, 7, 0, 1, 2, 3, 4, 5 }, { 0, 1, 6, 7, 2, 3, 4, 5 }, { 2, 3, 6, 7, 0, 1, 4, 5 }, { 0, 1, 2, 3, 6, 7, 4, 5 },
+		{ 4, 5, 6, 7, 0, 1, 2, 3 }, { 0, 1, 4, 5, 6, 7, 2, 3 }, { 2, 3, 4, 5, 6, 7, 0, 1 }, { 0, 1, 2, 3, 4, 5, 6, 7 }
+	};
+	static const int valid_count_table[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+	size_t valid_count = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		int valid_mask = ~invalid_mask_avx2(nums + i) & 0xF;
+		__m256i vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nums + i));
+		__m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(perm_table[valid_mask]));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(valid_nums + valid_count), _mm256_permutevar8x32_epi32(vec, perm));
+		valid_count += valid_count_table[valid_mask];
+	}
+	return valid_count + compact_valid_scalar(nums + i, count - i, valid_nums + valid_count);
+}
+
+/*
+Returns mask of invalid numbers in vector of 8 doubles (bit i set = number i invalid).
+*/
+TARGET_AVX512 static inline __mmask8 invalid_mask_avx512(__m512i bits)
+{
+	const __m512i abs_mask = _mm512_set1_epi64(static_cast<long long>(DOUBLE_ABS_MASK));
+	const __m512i exp_mask = _mm512_set1_epi64(static_cast<long long>(DOUBLE_EXP_MASK));
+	const __m512i zero = _mm512_setzero_si512();
+
+	__m512i exp_bits = _mm512_and_si512(bits, exp_mask);
+	__mmask8 inf_nan = _mm512_cmpeq_epi64_mask(exp_bits, exp_mask); //exponent all ones
+	__mmask8 zero_exp = _mm512_cmpeq_epi64_mask(exp_bits, zero);
+	__mmask8 nonzero_num = _mm512_cmpneq_epi64_mask(_mm512_and_si512(bits, abs_mask), zero);
+	return inf_nan | (zero_exp & nonzero_num); //infinity / NaN or subnormal
+}
+
+/*
+AVX-512 version of find_first_invalid, checks 8 doubles at once.
+*/
+TARGET_AVX512 size_t ValidityFilter::find_first_invalid_avx512(const double* nums, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__mmask8 invalid_mask = invalid_mask_avx512(_mm512_loadu_si512(nums + i));
+		if (invalid_mask != 0) {
+			for (int j = 0; j < 8; j++) { //position of lowest set bit
+				if (invalid_mask & (1 << j)) {
+					return i + j;
+				}
+			}
+		}
+	}
+	return i + find_first_invalid_scalar(nums + i, count - i);
+}
+
+/*
+AVX-512 version of compact_valid, valid numbers are written using compress store (only valid doubles are stored).
+*/
+TARGET_AVX512 size_t ValidityFilter::compact_valid_avx512(const double* nums, size_t count, double* valid_nums)
+{
+	size_t valid_count = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512i bits = _mm512_loadu_si512(nums + i);
+		__mmask8 valid_mask = static_cast<__mmask8>(~invalid_mask_avx512(bits));
+		_mm512_mask_compressstoreu_pd(valid_nums + valid_count, valid_mask, _mm512_castsi512_pd(bits));
+
+		int mask_bits = valid_mask;
+		while (mask_bits != 0) { //count of valid numbers
+			mask_bits &= mask_bits - 1;
+			valid_count++;
+		}
+	}
+	return valid_count + compact_valid_scalar(nums + i, count - i, valid_nums + valid_count);
+}
+#else
+/*
+Vector versions are not available on this platform, scalar versions are used.
+*/
+size_t ValidityFilter::find_first_invalid_avx2(const double* nums, size_t count)
+{
+	return find_first_invalid_scalar(nums, count);
+}
+
+size_t ValidityFilter::compact_valid_avx2(const double* nums, size_t count, double* valid_nums)
+{
+	return compact_valid_scalar(nums, count, valid_nums);
+}
+
+size_t ValidityFilter::find_first_invalid_avx512(const double* nums, size_t count)
+{
+	return find_first_invalid_scalar(nums, count);
+}
+
+size_t ValidityFilter::compact_valid_avx512(const double* nums, size_t count, double* valid_nums)
+{
+	return compact_valid_scalar(nums, count, valid_nums);
+}
+#endif
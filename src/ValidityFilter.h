@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+
+//instruction set used by validity filter
+enum simd_level {
+	SIMD_SCALAR, //plain C++, no vector instructions
+	SIMD_AVX2, //4 doubles at once
+	SIMD_AVX512 //8 doubles at once, compress store for compaction
+};
+
+//checks validity of numbers (std::fpclassify gives FP_NORMAL / FP_ZERO) using bit masks on raw representation of double; vector kernel is picked at runtime according to CPUID
+class ValidityFilter
+{
+	private:
+		static simd_level sel_simd_level; //instruction set picked for current CPU
+
+		static simd_level deter_simd_level(); //determines best instruction set supported by CPU + OS
+		static size_t find_first_invalid_scalar(const double* nums, size_t count); //scalar version of find_first_invalid
+		static size_t compact_valid_scalar(const double* nums, size_t count, double* valid_nums); //scalar version of compact_valid
+		static size_t find_first_invalid_avx2(const double* nums, size_t count); //AVX2 version of find_first_invalid
+		static size_t compact_valid_avx2(const double* nums, size_t count, double* valid_nums); //AVX2 version of compact_valid
+		static size_t find_first_invalid_avx512(const double* nums, size_t count); //AVX-512 version of find_first_invalid
+		static size_t compact_valid_avx512(const double* nums, size_t count, double* valid_nums); //AVX-512 version of compact_valid
+
+	public:
+		static size_t find_first_invalid(const double* nums, size_t count); //index of first invalid number (count if all valid)
+		static size_t compact_valid(const double* nums, size_t count, double* valid_nums); //copies valid numbers into preallocated buffer, returns their count
+		static simd_level get_simd_level(); //instruction set used by filter (used by other vector kernels as well)
+		static const char* get_simd_name(); //name of instruction set used by filter
+};
@@ -17,7 +17,9 @@ int timer_ms = timeout in timer_ms
 Watchdog::Watchdog(int timer_ms)
 {
 	this->timer_ms = std::chrono::milliseconds(timer_ms);
-	this->latest_reset_time = std::chrono::high_resolution_clock::now();
+	this->latest_reset_ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+	this->progress_stage = "initialization";
+	this->progress_bytes = 0;
 	this->dog_active = false;
 }
 
@@ -34,8 +36,9 @@ void Watchdog::start_watchdog()
 		return; //0 ms is not reasonable in this application
 	}
 	else { //all ok, start watchdog
-		this->dog_thread = std::thread(&Watchdog::watch_loop, this);
+		reset_timer();
 		this->dog_active = true;
+		this->dog_thread = std::thread(&Watchdog::watch_loop, this);
 		std::cout << "Watchdog started, reset timeout is " << WATCHDOG_TIMEOUT_MS << " ms." << std::endl;
 	}
 }
@@ -45,36 +48,58 @@ Stops watchdog from app watching (if already active, else does nothing).
 */
 void Watchdog::stop_watchdog()
 {
-	std::unique_lock<std::mutex>(dog_mutex);
-	if (!this->dog_active) {
-		return; //watchdog already disabled
-	}
-	else { //disable watchdog, nicely dispose thread
-		this->dog_active = false;
-		if (this->dog_thread.joinable()) {
-			this->dog_thread.join();
+	{
+		std::unique_lock<std::mutex> uniq_mutex(dog_mutex);
+		if (!this->dog_active) {
+			return; //watchdog already disabled
 		}
-		std::cout << "Watchdog operation finished, all ok." << std::endl;
+		this->dog_active = false;
+	}
+	this->dog_cond.notify_all(); //wake watching thread, it ends immediately
+
+	//disable watchdog, nicely dispose thread (mutex is not held, watching thread needs it to end)
+	if (this->dog_thread.joinable()) {
+		this->dog_thread.join();
 	}
+	std::cout << "Watchdog operation finished, all ok." << std::endl;
 }
 
 /*
-Function resets watchdog timer - called from other threads.
+Function resets watchdog timer - called from other threads. Only heartbeat is stored (no lock), watching thread checks it when it wakes up.
 */
 void Watchdog::reset_timer()
 {
-	std::unique_lock<std::mutex>(dog_mutex);
-	this->latest_reset_time = std::chrono::high_resolution_clock::now();
+	this->latest_reset_ticks.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+/*
+Function resets watchdog timer and sets progress tag, which is reported if computation stalls.
+const char* stage = name of stage of computation (string literal, pointer is stored)
+unsigned long long bytes_done = bytes of file processed in the stage
+*/
+void Watchdog::reset_timer(const char* stage, unsigned long long bytes_done)
+{
+	this->progress_stage.store(stage, std::memory_order_relaxed);
+	this->progress_bytes.store(bytes_done, std::memory_order_relaxed);
+	reset_timer();
 }
 
 /*
-Action periodically performed by watchdog thread.
+Action periodically performed by watchdog thread. Thread sleeps until timeout of latest reset (or deactivation of watchdog), then checks whether timer was reset in the meantime.
+Stall is reported once per timeout, together with progress tag of latest reset.
 */
 void Watchdog::watch_loop() {
-	std::unique_lock<std::mutex>(dog_mutex);
+	std::unique_lock<std::mutex> uniq_mutex(dog_mutex);
 	while (this->dog_active) {
-		if (std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now()) >= std::chrono::time_point_cast<std::chrono::milliseconds>(this->latest_reset_time) + this->timer_ms) {
-			std::cout << "Watchdog did not received reset signal and timeout occured. Please restart app, else results may be invalid..." << std::endl;
+		std::chrono::steady_clock::time_point latest_reset_time(std::chrono::steady_clock::duration(this->latest_reset_ticks.load(std::memory_order_relaxed)));
+		std::chrono::steady_clock::time_point timeout_time = latest_reset_time + this->timer_ms;
+
+		if (std::chrono::steady_clock::now() < timeout_time) { //timer still running, sleep until it may run out
+			this->dog_cond.wait_until(uniq_mutex, timeout_time, [this] { return !this->dog_active; });
+			continue;
 		}
+
+		std::cout << "Watchdog did not received reset signal and timeout occured during " << this->progress_stage.load(std::memory_order_relaxed) << " (" << this->progress_bytes.load(std::memory_order_relaxed) << " bytes processed). Please restart app, else results may be invalid..." << std::endl;
+		this->dog_cond.wait_for(uniq_mutex, this->timer_ms, [this] { return !this->dog_active; }); //next report after another timeout
 	}
-}
\ No newline at end of file
+}
@@ -2,6 +2,8 @@
 #include <chrono>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
 
 //contains utils related to program timer watchdog - for info about this watchdog concept see: https://en.wikipedia.org/wiki/Watchdog_timer.
@@ -10,11 +12,14 @@ class Watchdog
 	static Watchdog* instance; //singleton instance of the dog
 
 	private:
-		bool dog_active; //tells whether watchdog is activated
+		bool dog_active; //tells whether watchdog is activated (guarded by dog_mutex)
 		std::thread dog_thread; //thread reserved for watchdog
-		std::mutex dog_mutex; //timer reset is performed from multiple threads, mutex required
+		std::mutex dog_mutex; //guards activation of watchdog, used for sleeping of watching thread
+		std::condition_variable dog_cond; //wakes watching thread when watchdog is deactivated
 		std::chrono::milliseconds timer_ms; //if timer runs out, watchdog will generate timeout signal (in this case just prints message to inform user...)
-		std::chrono::steady_clock::time_point latest_reset_time; //latest time when was watchdog reseted
+		std::atomic<long long> latest_reset_ticks; //latest time when was watchdog reseted (heartbeat, ticks of steady clock) - reset does not lock
+		std::atomic<const char*> progress_stage; //stage of computation reported by latest reset with progress tag (string literal)
+		std::atomic<unsigned long long> progress_bytes; //bytes of file processed in the stage, reported by latest reset with progress tag
 		Watchdog(int timer_ms); //constructor expects timeout value (in ms); private constructor, avoid more instances
 		void watch_loop(); //action periodically performed by watching thread
 
@@ -22,5 +27,6 @@ class Watchdog
 		static Watchdog* get_instance(); //gets singleton instance
 		void start_watchdog(); //performs watchdog activation
 		void stop_watchdog(); //deactivates watchdog
-		void reset_timer(); //resets timer
-};
\ No newline at end of file
+		void reset_timer(); //resets timer, progress tag stays the same
+		void reset_timer(const char* stage, unsigned long long bytes_done); //resets timer + sets progress tag (reported if computation stalls)
+};
@@ -6,27 +6,130 @@ const std::string cl_src_add_nums_intervals = R"CLC(
 #pragma OPENCL EXTENSION cl_khr_int64_base_atomics: enable
 #pragma OPENCL EXTENSION cl_khr_int64_extended_atomics: enable
 
-__kernel void add_nums_intervals_avg(__global double* input_nums, int input_nums_size, __global int* output_intervals, int output_intervals_size, double interval_size, double min_value_data){
-	int index = get_global_id(0);
-	double input_num = input_nums[index];	
+//index of interval for given number, interval_size_recip = 1 / interval_size, min_value_scaled = min_value_data / interval_size (both computed once by host)
+int calc_interval_index(double input_num, double interval_size_recip, double min_value_scaled, int output_intervals_size){
+	double index_to_inc = input_num * interval_size_recip - min_value_scaled;
+	return (int)clamp(index_to_inc, 0.0, (double)(output_intervals_size - 1)); //last interval - include upper boundary, clamped before conversion (no int overflow)
+}
+
+//valid number - std::fpclassify gives FP_NORMAL / FP_ZERO (NaN, Inf and subnormal numbers are skipped)
+int is_valid_num(double num){
+	return isnormal(num) || num == 0.0;
+}
+
+//adds number to moments of work-item (Welfords online algorithm)
+void update_moments(double num, double* count, double* mean, double* m2){
+	*count += 1;
+	double delta = num - *mean;
+	*mean += delta / *count;
+	*m2 += delta * (num - *mean);
+}
+
+//merges moments of another part into given moments (Chan's formula, same as StatsKernel::merge_moments)
+void merge_moments(double part_count, double part_mean, double part_m2, double* count, double* mean, double* m2){
+	if (part_count == 0) {
+		return;
+	}
+	double count_total = *count + part_count;
+	double delta = part_mean - *mean;
+	*mean += delta * (part_count / count_total);
+	*m2 += part_m2 + delta * delta * (*count * part_count / count_total);
+	*count = count_total;
+}
+
+//tree reduction of moments of work-items (local size is power of two), first work-item merges result into partial of work-group
+//partials stay on device during whole pass - kernels of device run in order and each work-group has its own partial, so no atomics are needed
+void reduce_group_moments(double count, double mean, double m2, __global double* moment_partials, __local double* loc_moments){
+	int local_index = get_local_id(0);
+	int local_size = get_local_size(0);
+	__local double* loc_count = loc_moments;
+	__local double* loc_mean = loc_moments + local_size;
+	__local double* loc_m2 = loc_moments + 2 * local_size;
+
+	loc_count[local_index] = count;
+	loc_mean[local_index] = mean;
+	loc_m2[local_index] = m2;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (int stride = local_size / 2; stride > 0; stride /= 2) {
+		if (local_index < stride) {
+			merge_moments(loc_count[local_index + stride], loc_mean[local_index + stride], loc_m2[local_index + stride], &count, &mean, &m2);
+			loc_count[local_index] = count;
+			loc_mean[local_index] = mean;
+			loc_m2[local_index] = m2;
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if (local_index == 0) {
+		__global double* group_partial = moment_partials + get_group_id(0) * 3; //count, mean, M2
+		double partial_count = group_partial[0];
+		double partial_mean = group_partial[1];
+		double partial_m2 = group_partial[2];
+		merge_moments(count, mean, m2, &partial_count, &partial_mean, &partial_m2);
+		group_partial[0] = partial_count;
+		group_partial[1] = partial_mean;
+		group_partial[2] = partial_m2;
+	}
+}
+
+//one global 64-bit atomic per number, used when intervals do not fit into local memory of device; input contains raw numbers from file
+//moments of valid numbers (divided by normalize_val) are added to partial of work-group if calc_moments is set
+__kernel void add_nums_intervals_avg(__global double* input_nums, ulong input_nums_size, __global ulong* output_intervals, int output_intervals_size, double interval_size_recip, double min_value_scaled, __global double* moment_partials, int calc_moments, double normalize_val, __local double* loc_moments){
+	double count = 0;
+	double mean = 0;
+	double m2 = 0;
 
-	int index_to_inc;
-	if (min_value_data < 0) { //dataset minimum is < 0
-		double part_index_1 = input_num / interval_size;
-		double part_index_2 = fabs(min_value_data) / interval_size;
-		index_to_inc = part_index_1 + part_index_2;
+	for (size_t i = get_global_id(0); i < input_nums_size; i += get_global_size(0)) {
+		double input_num = input_nums[i];
+		if (!is_valid_num(input_num)) {
+			continue;
+		}
+		atom_inc(&output_intervals[calc_interval_index(input_num, interval_size_recip, min_value_scaled, output_intervals_size)]);
+		if (calc_moments) {
+			update_moments(input_num / normalize_val, &count, &mean, &m2);
+		}
 	}
-	else {
-		double part_index_1 = input_num / interval_size;
-		double part_index_2 = min_value_data / interval_size;
-		index_to_inc = part_index_1 - part_index_2;
+
+	if (calc_moments) { //same value for whole work-group => barriers are reached by all work-items
+		reduce_group_moments(count, mean, m2, moment_partials, loc_moments);
+	}
+}
+
+//each work-group counts numbers into its own intervals in local memory, global intervals are updated once per work-group; input contains raw numbers from file
+//moments are calculated in the same way as in add_nums_intervals_avg
+__kernel void add_nums_intervals_local(__global double* input_nums, ulong input_nums_size, __global ulong* output_intervals, int output_intervals_size, double interval_size_recip, double min_value_scaled, __global double* moment_partials, int calc_moments, double normalize_val, __local double* loc_moments, __local uint* loc_intervals){
+	int local_index = get_local_id(0);
+	int local_size = get_local_size(0);
+	double count = 0;
+	double mean = 0;
+	double m2 = 0;
+
+	for (int i = local_index; i < output_intervals_size; i += local_size) { //clear intervals of work-group
+		loc_intervals[i] = 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (size_t i = get_global_id(0); i < input_nums_size; i += get_global_size(0)) {
+		double input_num = input_nums[i];
+		if (is_valid_num(input_num)) {
+			atomic_inc(&loc_intervals[calc_interval_index(input_num, interval_size_recip, min_value_scaled, output_intervals_size)]);
+			if (calc_moments) {
+				update_moments(input_num / normalize_val, &count, &mean, &m2);
+			}
+		}
 	}
+	barrier(CLK_LOCAL_MEM_FENCE);
 
-	if ((int)index_to_inc == output_intervals_size) { //last interval - include upper boundary
-		index_to_inc = output_intervals_size - 1;
+	for (int i = local_index; i < output_intervals_size; i += local_size) { //flush non-empty intervals to global memory
+		if (loc_intervals[i] != 0) {
+			atom_add(&output_intervals[i], (ulong)loc_intervals[i]); //32-bit counts of work-group flushed into 64-bit global counts
+		}
 	}
 
-	atom_inc(&output_intervals[index_to_inc]);
+	if (calc_moments) {
+		reduce_group_moments(count, mean, m2, moment_partials, loc_moments);
+	}
 }
 )CLC";
 
@@ -34,26 +137,71 @@ const std::string cl_src_min_max_dec_point_neg_num = R"CLC(
 #pragma OPENCL EXTENSION cl_khr_int64_base_atomics: enable
 #pragma OPENCL EXTENSION cl_khr_int64_extended_atomics: enable
 
-__kernel void min_max_dec_point_neg_num(__global ulong* res_min_value_pos, __global ulong* res_max_value_pos, __global ulong* res_min_value_neg, __global ulong* res_max_value_neg, __global int* res_dec_point_num, volatile __global double* input_nums, int input_nums_size)
+#define FLAG_DEC_POINT_NUM 1
+#define FLAG_NEGATIVE_NUM 2
+
+//maps double to ulong key with the same ordering (negative numbers have flipped bits), so min / max can be done by ulong atomics
+ulong num_to_key(double num){
+	ulong bits = as_ulong(num);
+	return (bits & 0x8000000000000000UL) ? ~bits : (bits | 0x8000000000000000UL);
+}
+
+//valid number - std::fpclassify gives FP_NORMAL / FP_ZERO (NaN, Inf and subnormal numbers are skipped)
+int is_valid_num(double num){
+	return isnormal(num) || num == 0.0;
+}
+
+//each work-item reduces several numbers in registers (grid-stride loop), work-group reduces in local memory, only first work-item of group updates global results
+//input contains raw numbers from file, invalid ones are skipped and valid ones counted
+__kernel void min_max_dec_point_neg_num(__global ulong* res_min_key, __global ulong* res_max_key, __global int* res_flags, __global ulong* res_count, __global const double* input_nums, ulong input_nums_size, __local ulong* loc_min_key, __local ulong* loc_max_key, __local int* loc_flags, __local uint* loc_count)
 {
-	int index = get_global_id(0);
-	double input_num_orig = input_nums[index];
-	ulong input_num_mod = as_ulong(fabs(input_num_orig));
+	int local_index = get_local_id(0);
+	int local_size = get_local_size(0);
+
+	ulong min_key = ULONG_MAX;
+	ulong max_key = 0;
+	int flags = 0;
+	uint count = 0;
 
-	int dec_point_num = 0;
+	for (size_t i = get_global_id(0); i < input_nums_size; i += get_global_size(0)) { //consecutive work-items read consecutive numbers
+		double input_num = input_nums[i];
+		if (!is_valid_num(input_num)) {
+			continue;
+		}
+		ulong key = num_to_key(input_num);
+		min_key = min(min_key, key);
+		max_key = max(max_key, key);
 
-	if(input_num_orig < 0){
-		atom_min(res_min_value_neg, input_num_mod);
-		atom_max(res_max_value_neg, input_num_mod);
-	}else{
-		atom_min(res_min_value_pos, input_num_mod);
-		atom_max(res_max_value_pos, input_num_mod);
+		if (input_num != trunc(input_num)) { //num represents decimal point number
+			flags |= FLAG_DEC_POINT_NUM;
+		}
+		if (input_num < 0) { //num is negative
+			flags |= FLAG_NEGATIVE_NUM;
+		}
+		count++;
 	}
 
-	if (fmod(input_num_orig, 1) != 0) { //num represents decimal point number
-		dec_point_num = 1;
+	loc_min_key[local_index] = min_key;
+	loc_max_key[local_index] = max_key;
+	loc_flags[local_index] = flags;
+	loc_count[local_index] = count;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (int stride = local_size / 2; stride > 0; stride /= 2) { //tree reduction, local size is power of two
+		if (local_index < stride) {
+			loc_min_key[local_index] = min(loc_min_key[local_index], loc_min_key[local_index + stride]);
+			loc_max_key[local_index] = max(loc_max_key[local_index], loc_max_key[local_index + stride]);
+			loc_flags[local_index] |= loc_flags[local_index + stride];
+			loc_count[local_index] += loc_count[local_index + stride];
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
 	}
 
-	atom_max(res_dec_point_num, dec_point_num); //atleast one number is decimal (1)
+	if (local_index == 0 && loc_count[0] > 0) { //one set of atomics per work-group
+		atom_min(res_min_key, loc_min_key[0]);
+		atom_max(res_max_key, loc_max_key[0]);
+		atomic_or(res_flags, loc_flags[0]);
+		atom_add(res_count, (ulong)loc_count[0]);
+	}
 }
 )CLC";
\ No newline at end of file
@@ -1,7 +1,37 @@
 #pragma once
 const int DOUBLE_READ_COUNT_ONCE = 100000; //number of doubles which should be read from file at once
-const int MAX_OUTPUT_INTERVAL_COUNT = 500; //maximum of output intervals into which numbers will be sorted
+const int PREFETCH_QUEUE_DEPTH = 4; //number of chunks which are read ahead of computation by reader thread
+const int READ_THREAD_COUNT = 1; //number of reader threads which read different chunks of file concurrently
+const int MOMENT_BLOCK_NUMS = 4096; //count of numbers in one block whose partial moments (count, mean, M2) are calculated by one task
+const int DIRECT_IO_ALIGNMENT = 4096; //alignment of file offset, length and buffer address required by direct (unbuffered) reads
+const int MAX_READ_THREAD_COUNT = 64; //maximal number of reader threads which can be set by user
+const int CL_RING_DEPTH = 2; //number of input buffers of each OpenCL device (chunks in flight - upload of next chunk overlaps kernel of previous)
+const int MAX_CL_RING_DEPTH = 16; //maximal number of input buffers of OpenCL device which can be set by user
+const double SCHED_THROUGHPUT_SMOOTHING = 0.25; //weight of last measured throughput of device in its smoothed throughput (scheduler)
+const int CL_REDUCTION_GROUP_SIZE = 256; //preferred work-group size of OpenCL reduction kernels (lowered to device limit, power of two)
+const int CL_REDUCTION_NUMS_PER_ITEM = 16; //count of numbers reduced in registers by one OpenCL work-item
+const int CL_MOMENT_PARTIAL_COUNT = 1024; //maximal count of work-groups of second round OpenCL kernels = count of partial moments kept on each device
+const int CL_FLAG_DEC_POINT_NUM = 1; //bit of OpenCL first round result flags - decimal point number found
+const int CL_FLAG_NEGATIVE_NUM = 2; //bit of OpenCL first round result flags - negative number found
+const int SMP_INTERVAL_BATCH_NUMS = 256; //count of numbers whose interval indexes are calculated at once by SMP (vectorized loop)
+const int SMP_SHARED_INTERVALS_MIN = 32768; //count of intervals from which SMP threads share one histogram with atomic counters (histogram per thread would not fit into cache)
+const int ADAPTIVE_HIST_BIN_COUNT = 65536; //count of fine bins of provisional histogram (single pass mode)
+const unsigned long long FNV_HASH_OFFSET = 14695981039346656037ULL; //initial value of FNV-1a hash
+const unsigned long long FNV_HASH_PRIME = 1099511628211ULL; //prime used by FNV-1a hash
+const char RUN_REPORT_FILE_NAME[] = "pprsolver_report.json"; //default file into which JSON run report (wall time of stages, throughput of devices) is written
+const char STDIN_FILE_NAME[] = "-"; //file name which means that numbers are streamed from standard input
+const char CL_BUILD_OPTIONS[] = "-cl-std=CL2.0"; //options used when OpenCL programs are built
+const char CL_BINARY_CACHE_MAGIC[8] = { 'P', 'P', 'R', 'C', 'L', 'B', '0', '1' }; //identifies cache file with OpenCL program binary (+ its version)
+const char CL_BINARY_CACHE_DIR_NAME[] = "pprsolver_cl_cache"; //directory (inside cache directory of the user) with cached OpenCL program binaries
+const unsigned long long CL_BINARY_CACHE_MAX_SIZE = 256ULL * 1024 * 1024; //maximal size of cached binary, larger size means corrupted file
+const char BLOCK_INDEX_MAGIC[8] = { 'P', 'P', 'R', 'I', 'D', 'X', '0', '1' }; //identifies sidecar file with block statistics (+ its version)
+const char BLOCK_INDEX_FILE_SUFFIX[] = ".pprindex"; //suffix of sidecar file with block statistics (appended to input file name)
+const int BLOCK_INDEX_SAMPLE_COUNT = 16; //count of file parts hashed to check that indexed file did not change
+const int BLOCK_INDEX_SAMPLE_NUMS = 8192; //count of doubles in one hashed file part
 const int WATCHDOG_TIMEOUT_MS = 10000; //watchdog timeout in ms
 const double PI = 3.14159265358979323846; //PI value
+const int POISSON_GAMMA_MAX_ITER = 1000000; //maximal count of terms of series / continued fraction of incomplete gamma function (count needed grows with square root of lambda)
+const double POISSON_GAMMA_EPS = 1e-15; //relative precision of incomplete gamma function
+const double POISSON_STIRLING_MIN = 50; //parameter of incomplete gamma function from which its prefactor is calculated using Stirling series (precise for large lambda)
 const int STANDARDIZE_DIST_ARR_SIZE = 4501; //size of array with results of distribution function for standardized intervals 
 const double STANDARDIZE_DIST_ARR_STEP = 0.001; //step of array with distribution function results
\ No newline at end of file